@@ -0,0 +1,59 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// expr-direct-parser.h is generated at build time by 'parsegen --emit-code', from the same grammar and
+// options as parse-tables.h. It defines its own TokenType and reduce_info, so it is compiled apart
+// from evaluator.h, in a namespace of its own (the standard headers it includes are included above),
+// and bench-expressions.cpp calls it through the two functions below.
+namespace direct {
+#include "expr-direct-parser.h"
+}
+
+using namespace direct;
+
+bool direct_recognize(const uint32_t* tokens, size_t count, std::vector<size_t>& states) {
+	return direct_parse(tokens, count, states, [](size_t) {}, [](size_t) {});
+}
+
+// 'texts' are the values of the tokens, as scanned
+bool direct_evaluate(const uint32_t* tokens, const std::string* texts, size_t count, std::vector<size_t>& states,
+	std::vector<float>& values, float& output)
+{
+	enum Operation { NONE, NEGATE, ADD, SUB, MUL, DIV };
+	static const auto operations = [] {
+		std::vector<Operation> operations;
+		for (auto& info : reduce_info) {
+			operations.push_back(info.first == "Unary" ? NEGATE : info.first == "Add" ? ADD : info.first == "Sub" ? SUB
+				: info.first == "Mul" ? MUL : info.first == "Div" ? DIV : NONE);
+		}
+		return operations;
+	}();
+
+	values.clear();
+	auto on_shift = [&](size_t position) {
+		if (tokens[position] == t_NUMBER) values.push_back(std::stoi(texts[position]));
+	};
+	auto on_reduce = [&](size_t rule) {
+		auto operation = operations[rule];
+		if (operation == NONE) return;
+		if (operation == NEGATE) {
+			values.back() = -values.back();
+			return;
+		}
+
+		auto rhs = values.back();
+		values.pop_back();
+		auto& lhs = values.back();
+		if (operation == ADD) lhs += rhs;
+		else if (operation == SUB) lhs -= rhs;
+		else if (operation == MUL) lhs *= rhs;
+		else lhs /= rhs;
+	};
+	if (!direct_parse(tokens, count, states, on_shift, on_reduce)) return false;
+	output = values.back();
+	return true;
+}
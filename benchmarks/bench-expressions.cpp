@@ -0,0 +1,438 @@
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../math-expressions/evaluator.h"
+#include "../runtime/binary-tables.h"
+#include "../runtime/lazy-tables.h"
+#include "../runtime/parse-tree.h"
+#include "bench-harness.h"
+
+// Runtime benchmark of the 'mathematical expressions' scanner, parser and evaluator.
+//
+// Phases: 'scan' turns input text into tokens, 'parse' only recognizes the scanned tokens,
+// 'evaluate' parses them and applies the semantic actions, 'tree' parses them into a parse tree. The
+// evaluate drivers are checked against the evaluator on the value of every input, and the tree drivers
+// against the arena on its nodes. Drivers:
+//   scanner    scan() of evaluator.h
+//   evaluator  parse() of evaluator.h, as used by the REPL and the server (std::stack per input)
+//   vector     the same table walk, with state and value stacks in vectors kept across inputs
+//   binary     Tables::parse() of runtime/binary-tables.h, over the blob generated at build time from
+//              the same grammar and options as parse-tables.h (EXPRESSIONS_TABLES_BLOB)
+//   lazy       Tables::parse() of runtime/lazy-tables.h, building its rows from the grammar blob
+//              (EXPRESSIONS_LAZY_GRAMMAR) during the first inputs
+//   direct     direct_parse() of the parser generated at build time by --emit-code, with the same
+//              options as parse-tables.h (bench-expressions-direct.cpp)
+//   arena      the binary driver, into a parse_tree::Tree of runtime/parse-tree.h kept across inputs
+//   pointer    the binary driver, into a tree of separately allocated nodes (PointerNode)
+//   threads    the lazy driver on lazy_threads threads at once, all evaluating the same input over tables
+//              attached cold for it, so they race to build the same rows; its result is the value only
+//              if every thread got it. Build with -fsanitize=thread to check the lock-free lookups.
+
+static std::string number(std::mt19937& random) {
+	return std::to_string(std::uniform_int_distribution<int>(1, 99)(random));
+}
+
+static char binary_operator(std::mt19937& random) {
+	static const char operators[] = { '+', '-', '*', '/' };
+	return operators[std::uniform_int_distribution<int>(0, 3)(random)];
+}
+
+// '((((n))))', 'depth' parentheses deep
+static std::string nested(size_t depth, std::mt19937& random) {
+	return std::string(depth, '(') + number(random) + std::string(depth, ')');
+}
+
+// 'n op n op ... n', with 'operators' binary operators
+static std::string chain(size_t operators, std::mt19937& random) {
+	auto expression = number(random);
+	for (size_t i = 0; i < operators; i++) {
+		expression += binary_operator(random);
+		expression += number(random);
+	}
+	return expression;
+}
+
+// A random expression tree with 'operators' binary operators, some operands negated and some
+// subexpressions parenthesized
+static std::string random_expression(size_t operators, std::mt19937& random) {
+	std::uniform_int_distribution<int> percent(0, 99);
+	if (operators == 0) {
+		return (percent(random) < 10 ? "-" : "") + number(random);
+	}
+
+	auto left = std::uniform_int_distribution<size_t>(0, operators - 1)(random);
+	auto expression = random_expression(left, random) + binary_operator(random) + random_expression(operators - 1 - left, random);
+	return percent(random) < 30 ? "(" + expression + ")" : expression;
+}
+
+static bool apply(std::string_view reduce_symbol, std::vector<float>& values) {
+	if (reduce_symbol == "Unary") {
+		values.back() = -values.back();
+		return true;
+	}
+	if (reduce_symbol != "Add" && reduce_symbol != "Sub" && reduce_symbol != "Mul" && reduce_symbol != "Div") return true;
+
+	auto rhs = values.back();
+	values.pop_back();
+	auto& lhs = values.back();
+	if (reduce_symbol == "Add") lhs += rhs;
+	else if (reduce_symbol == "Sub") lhs -= rhs;
+	else if (reduce_symbol == "Mul") lhs *= rhs;
+	else lhs /= rhs;
+	return true;
+}
+
+// parse() of evaluator.h, with the stacks supplied by the caller, and semantic actions
+// only applied when 'evaluate'
+template<bool evaluate>
+static bool vector_parse(const std::vector<Token>& tokens, std::vector<size_t>& states, std::vector<float>& values, float& output) {
+	states.clear();
+	values.clear();
+	states.push_back(0);
+
+	for (size_t i = 0; i < tokens.size();) {
+		auto state = states.back();
+		size_t index;
+		size_t pop_count;
+
+		auto default_reduction = default_reductions[state];
+		if (default_reduction != NO_DEFAULT_REDUCTION) {
+			index = default_reduction;
+			pop_count = reduce_info[index].second;
+		}
+		else {
+			auto action_entry = actionTable.find(std::make_pair(state, tokens[i].type));
+			if (action_entry == actionTable.end()) return false;
+
+			auto& action = action_entry->second;
+			if (action.type == ActionType::ACCEPT) {
+				if (evaluate) output = values.back();
+				return true;
+			}
+			if (action.type == ActionType::REDUCE) {
+				index = action.value;
+				pop_count = reduce_info[index].second;
+			}
+			else {
+				if (evaluate && tokens[i].type == t_NUMBER) values.push_back(std::stoi(tokens[i].value));
+				++i;
+				if (action.type == ActionType::SHIFT) {
+					states.push_back(action.value);
+					continue;
+				}
+				index = action.value;
+				pop_count = reduce_info[index].second - 1;
+			}
+		}
+
+		states.resize(states.size() - pop_count);
+		auto reduce_symbol = reduce_info[index].first;
+		auto goto_entry = gotoTable.find(std::make_pair(states.back(), reduce_symbol));
+		if (goto_entry == gotoTable.end()) return false;
+		states.push_back(goto_entry->second);
+		if (evaluate) apply(reduce_symbol, values);
+	}
+	return false;
+}
+
+// bench-expressions-direct.cpp
+bool direct_recognize(const uint32_t* tokens, size_t count, std::vector<size_t>& states);
+bool direct_evaluate(const uint32_t* tokens, const std::string* texts, size_t count, std::vector<size_t>& states,
+	std::vector<float>& values, float& output);
+
+enum Operation { NONE, NEGATE, ADD, SUB, MUL, DIV };
+
+static void apply(Operation operation, std::vector<float>& values) {
+	if (operation == NONE) return;
+	if (operation == NEGATE) {
+		values.back() = -values.back();
+		return;
+	}
+
+	auto rhs = values.back();
+	values.pop_back();
+	auto& lhs = values.back();
+	if (operation == ADD) lhs += rhs;
+	else if (operation == SUB) lhs -= rhs;
+	else if (operation == MUL) lhs *= rhs;
+	else lhs /= rhs;
+}
+
+// The operation of every rule of 'tables', or nothing if they do not match reduce_info
+static std::vector<Operation> operations_of(const binary_tables::Tables& tables) {
+	static const std::pair<std::string_view, Operation> names[] = {
+		{ "Unary", NEGATE }, { "Add", ADD }, { "Sub", SUB }, { "Mul", MUL }, { "Div", DIV }
+	};
+	if (tables.rule_count() != reduce_info.size() || tables.state_count() != default_reductions.size()) return {};
+
+	std::vector<Operation> operations;
+	for (uint32_t rule = 0; rule < tables.rule_count(); rule++) {
+		auto lhs = tables.non_terminal_name(tables.rule_lhs(rule));
+		if (lhs != reduce_info[rule].first || tables.rule_pop_count(rule) != reduce_info[rule].second) return {};
+
+		operations.push_back(NONE);
+		for (auto& name : names) {
+			if (lhs == name.first) operations.back() = name.second;
+		}
+	}
+	return operations;
+}
+
+// The operation of every rule of the lazy tables, by the name of its LHS
+static std::vector<Operation> operations_of(const lazy_tables::Tables& tables) {
+	static const std::pair<std::string_view, Operation> names[] = {
+		{ "Unary", NEGATE }, { "Add", ADD }, { "Sub", SUB }, { "Mul", MUL }, { "Div", DIV }
+	};
+	std::vector<Operation> operations;
+	for (uint32_t rule = 0; rule < tables.rule_count(); rule++) {
+		operations.push_back(NONE);
+		for (auto& name : names) {
+			if (tables.non_terminal_name(tables.rule_lhs(rule)) == name.first) operations.back() = name.second;
+		}
+	}
+	return operations;
+}
+
+// Evaluate scanned[index] ('input' as terminal indices) over lazy tables, with the stacks supplied by
+// the caller
+static bool lazy_evaluate(lazy_tables::Tables& tables, const std::vector<Operation>& operations, const std::vector<Token>& tokens,
+	const std::vector<uint32_t>& input, std::vector<uint32_t>& states, std::vector<float>& values, float& output)
+{
+	values.clear();
+	auto on_shift = [&](size_t position) {
+		if (tokens[position].type == t_NUMBER) values.push_back(std::stoi(tokens[position].value));
+	};
+	auto on_reduce = [&](uint32_t rule) { apply(operations[rule], values); };
+	if (!tables.parse(input.data(), input.size(), states, on_shift, on_reduce)) return false;
+	output = values.back();
+	return true;
+}
+
+// Threads of the 'threads' driver
+constexpr size_t lazy_threads = 4;
+
+// A parse tree node as a tree is usually built without a tree builder: allocated by the semantic action
+// of its rule, and owning its children
+struct PointerNode {
+	uint32_t rule;
+	uint32_t token_begin;
+	uint32_t token_end;
+	std::vector<std::unique_ptr<PointerNode>> children;
+};
+
+// A random expression with one character replaced by an operator, a parenthesis or a digit, which
+// usually makes it malformed. Every driver must reject the same inputs.
+static std::string malformed_expression(size_t operators, std::mt19937& random) {
+	static const char replacements[] = { '+', '-', '*', '/', '(', ')', '7' };
+	auto expression = random_expression(operators, random);
+	auto position = std::uniform_int_distribution<size_t>(0, expression.size() - 1)(random);
+	expression[position] = replacements[std::uniform_int_distribution<size_t>(0, sizeof(replacements) - 1)(random)];
+	return expression;
+}
+
+// The check value of the tree drivers: a hash of every node's rule, token span and number of children,
+// in the order the nodes were built
+static uint64_t hash_node(uint64_t check, uint32_t rule, uint32_t token_begin, uint32_t token_end, size_t child_count) {
+	return bench::hash(bench::hash(bench::hash(bench::hash(check, rule), token_begin), token_end), child_count);
+}
+
+int main(int argc, char** argv) {
+	bench::Options options;
+	if (!bench::parse_options(argc, argv, options)) {
+		bench::print_usage(argv[0], "nested, chain, random, malformed");
+		return 1;
+	}
+
+	std::mt19937 random(options.seed);
+	std::vector<bench::Workload> workloads{ { "nested", {}, true }, { "chain", {}, true }, { "random", {}, true },
+		{ "malformed", {}, false } };
+	for (size_t i = 0; i < options.inputs; i++) {
+		workloads[0].inputs.push_back(nested(options.size, random));
+		workloads[1].inputs.push_back(chain(options.size, random));
+		workloads[2].inputs.push_back(random_expression(options.size, random));
+		workloads[3].inputs.push_back(malformed_expression(options.size, random));
+	}
+
+	std::vector<std::vector<Token>> scanned;
+	std::vector<Token> tokens;
+	std::string errors;
+	std::vector<size_t> states;
+	std::vector<float> values;
+	float output = 0;
+	uint64_t tree_check = 0;
+
+	binary_tables::Tables tables;
+	std::string tables_error;
+	if (!tables.open(EXPRESSIONS_TABLES_BLOB, tables_error)) {
+		std::cout << "binary driver disabled: " << tables_error << "\n";
+	}
+	auto operations = operations_of(tables);
+	if (tables.state_count() && operations.empty()) {
+		std::cout << "binary driver disabled: " << EXPRESSIONS_TABLES_BLOB << " does not match parse-tables.h\n";
+	}
+	lazy_tables::Tables lazy;
+	if (!lazy.open(EXPRESSIONS_LAZY_GRAMMAR, tables_error)) {
+		std::cout << "lazy driver disabled: " << tables_error << "\n";
+	}
+	auto lazy_operations = operations_of(lazy);
+	std::ifstream lazy_file(EXPRESSIONS_LAZY_GRAMMAR, std::ios::in | std::ios::binary);
+	std::vector<char> lazy_grammar((std::istreambuf_iterator<char>(lazy_file)), std::istreambuf_iterator<char>());
+	lazy_tables::Tables cold_lazy;
+	std::vector<std::vector<uint32_t>> terminals;
+	std::vector<std::vector<std::string>> texts;
+	std::vector<uint32_t> binary_states;
+	parse_tree::Tree tree;
+	// the pending RHS symbols of the pointer tree: a node, or nullptr for a token, and its first token
+	std::vector<std::pair<std::unique_ptr<PointerNode>, uint32_t>> pointer_symbols;
+	std::unique_ptr<PointerNode> pointer_root;
+
+	auto drivers_for = [&](const bench::Workload& workload) {
+		scanned.assign(workload.inputs.size(), {});
+		for (size_t i = 0; i < workload.inputs.size(); i++) {
+			scan(workload.inputs[i], scanned[i], errors);
+		}
+		terminals.assign(scanned.size(), {});
+		texts.assign(scanned.size(), {});
+		for (size_t i = 0; i < scanned.size(); i++) {
+			for (auto& token : scanned[i]) {
+				terminals[i].push_back(token.type);
+				texts[i].push_back(token.value);
+			}
+		}
+
+		std::vector<bench::Driver> drivers{
+			{ "scan", "scanner", true, [&](size_t index) {
+				tokens.clear();
+				return scan(workload.inputs[index], tokens, errors) ? tokens.size() : 0;
+			} },
+			{ "parse", "vector", true, [&](size_t index) {
+				return vector_parse<false>(scanned[index], states, values, output) ? scanned[index].size() : 0;
+			} },
+			{ "evaluate", "evaluator", true, [&](size_t index) -> bench::Result {
+				if (!parse(scanned[index], output)) return 0;
+				return { scanned[index].size(), bench::check_of(output) };
+			} },
+			{ "parse", "direct", false, [&](size_t index) {
+				auto& input = terminals[index];
+				return direct_recognize(input.data(), input.size(), states) ? input.size() : 0;
+			} },
+			{ "evaluate", "vector", false, [&](size_t index) -> bench::Result {
+				if (!vector_parse<true>(scanned[index], states, values, output)) return 0;
+				return { scanned[index].size(), bench::check_of(output) };
+			} },
+			{ "evaluate", "direct", false, [&](size_t index) -> bench::Result {
+				auto& input = terminals[index];
+				if (!direct_evaluate(input.data(), texts[index].data(), input.size(), states, values, output)) return 0;
+				return { input.size(), bench::check_of(output) };
+			} },
+		};
+		if (!operations.empty()) {
+			drivers.insert(drivers.begin() + 2, { "parse", "binary", false, [&](size_t index) {
+				auto& input = terminals[index];
+				return tables.parse(input.data(), input.size(), binary_states, [](size_t) {}, [](uint32_t) {}) ? input.size() : 0;
+			} });
+			drivers.push_back({ "evaluate", "binary", false, [&](size_t index) -> bench::Result {
+				auto& tokens = scanned[index];
+				auto& input = terminals[index];
+				values.clear();
+				auto on_shift = [&](size_t position) {
+					if (tokens[position].type == t_NUMBER) values.push_back(std::stoi(tokens[position].value));
+				};
+				auto on_reduce = [&](uint32_t rule) { apply(operations[rule], values); };
+				if (!tables.parse(input.data(), input.size(), binary_states, on_shift, on_reduce)) return 0;
+				output = values.back();
+				return { input.size(), bench::check_of(output) };
+			} });
+			drivers.push_back({ "tree", "arena", true, [&](size_t index) -> bench::Result {
+				auto& input = terminals[index];
+				tree.clear();
+				tree_check = bench::hash_seed;
+				auto on_shift = [&](size_t position) { tree.shift(position); };
+				auto on_reduce = [&](uint32_t rule) {
+					auto node = tree.reduce(rule, tables.rule_pop_count(rule));
+					tree_check = hash_node(tree_check, tree.rule(node), tree.token_begin(node), tree.token_end(node), tree.child_count(node));
+				};
+				if (!tables.parse(input.data(), input.size(), binary_states, on_shift, on_reduce)) return 0;
+				return { input.size(), tree_check };
+			} });
+			drivers.push_back({ "tree", "pointer", false, [&](size_t index) -> bench::Result {
+				auto& input = terminals[index];
+				pointer_root.reset();
+				pointer_symbols.clear();
+				tree_check = bench::hash_seed;
+				uint32_t next_token = 0;
+				auto on_shift = [&](size_t position) {
+					next_token = static_cast<uint32_t>(position + 1);
+					pointer_symbols.emplace_back(nullptr, static_cast<uint32_t>(position));
+				};
+				auto on_reduce = [&](uint32_t rule) {
+					auto pop_count = tables.rule_pop_count(rule);
+					auto node = std::make_unique<PointerNode>();
+					node->rule = rule;
+					node->token_begin = pop_count ? pointer_symbols[pointer_symbols.size() - pop_count].second : next_token;
+					node->token_end = next_token;
+					for (auto symbol = pointer_symbols.end() - pop_count; symbol != pointer_symbols.end(); ++symbol) {
+						if (symbol->first) node->children.push_back(std::move(symbol->first));
+					}
+					pointer_symbols.resize(pointer_symbols.size() - pop_count);
+					tree_check = hash_node(tree_check, node->rule, node->token_begin, node->token_end, node->children.size());
+					auto token_begin = node->token_begin;
+					pointer_symbols.emplace_back(std::move(node), token_begin);
+				};
+				if (!tables.parse(input.data(), input.size(), binary_states, on_shift, on_reduce)) return 0;
+				pointer_root = std::move(pointer_symbols.back().first);
+				return { input.size(), tree_check };
+			} });
+		}
+		if (!lazy_operations.empty()) {
+			auto last_parse = std::find_if(drivers.rbegin(), drivers.rend(), [](const bench::Driver& driver) { return driver.phase == "parse"; }).base();
+			drivers.insert(last_parse, { "parse", "lazy", false, [&](size_t index) {
+				auto& input = terminals[index];
+				return lazy.parse(input.data(), input.size(), binary_states, [](size_t) {}, [](uint32_t) {}) ? input.size() : 0;
+			} });
+			drivers.push_back({ "evaluate", "lazy", false, [&](size_t index) -> bench::Result {
+				if (!lazy_evaluate(lazy, lazy_operations, scanned[index], terminals[index], binary_states, values, output)) return 0;
+				return { terminals[index].size(), bench::check_of(output) };
+			} });
+			drivers.push_back({ "evaluate", "threads", false, [&](size_t index) -> bench::Result {
+				if (!cold_lazy.attach(lazy_grammar.data(), lazy_grammar.size(), tables_error)) return 0;
+
+				std::atomic<bool> start{ false };
+				bool accepted[lazy_threads];
+				float outputs[lazy_threads];
+				std::vector<std::thread> threads;
+				for (size_t thread = 0; thread < lazy_threads; thread++) {
+					threads.emplace_back([&, thread] {
+						std::vector<uint32_t> thread_states;
+						std::vector<float> thread_values;
+						while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+						accepted[thread] = lazy_evaluate(cold_lazy, lazy_operations, scanned[index], terminals[index], thread_states,
+							thread_values, outputs[thread]);
+					});
+				}
+				start.store(true, std::memory_order_release);
+				for (auto& thread : threads) thread.join();
+
+				for (size_t thread = 1; thread < lazy_threads; thread++) {
+					if (accepted[thread] != accepted[0] || (accepted[0] && bench::check_of(outputs[thread]) != bench::check_of(outputs[0]))) {
+						return { 0, 1 }; // the threads disagree
+					}
+				}
+				if (!accepted[0]) return 0;
+				return { terminals[index].size(), bench::check_of(outputs[0]) };
+			} });
+		}
+		return drivers;
+	};
+
+	bench::run(workloads, drivers_for, options);
+	return 0;
+}
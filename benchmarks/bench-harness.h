@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Measurement and reporting shared by the runtime benchmarks (bench_expressions, bench_parentheses).
+//
+// Every workload is a set of generated inputs. Each phase (scanning, parsing, evaluation) runs over
+// all of them 'rounds' times through a driver, a particular implementation of that phase, and is
+// timed input by input: throughput is reported in tokens and bytes per second of measured time,
+// along with latency percentiles and the heap allocations made per input. The first driver of a phase
+// is its reference: every other driver must accept the same inputs and produce the same result for
+// each of them, or the input counts as failed.
+//
+// The global operator new/delete are replaced to count allocations, so this header must be
+// included by exactly one translation unit of a benchmark executable. Allocations are counted per
+// thread, and a measurement counts those of the thread running the driver.
+
+namespace bench {
+
+inline thread_local size_t allocations = 0;
+inline thread_local size_t allocated_bytes = 0;
+
+} // namespace bench
+
+void* operator new(std::size_t size) {
+	++bench::allocations;
+	bench::allocated_bytes += size;
+	if (auto memory = std::malloc(size ? size : 1)) return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+	size_t inputs = 100;  // inputs generated per workload
+	size_t size = 2000;   // nesting depth, or number of operators/pairs, of every input
+	size_t rounds = 5;    // passes over the inputs of a workload
+	unsigned seed = 1;
+	bool compare = false; // run every driver of a phase, not just the default one
+	std::string workload; // run this workload only
+};
+
+struct Workload {
+	std::string name;
+	std::vector<std::string> inputs;
+	bool well_formed = true; // a rejected input is a failure, rather than a result to compare
+};
+
+// What a driver made of one input: the number of tokens it processed, or 0 if it rejected the input,
+// and a check value of its output (the evaluated value, a hash of the tree built, ...). A driver that
+// only recognizes its inputs returns its token count alone.
+struct Result {
+	size_t tokens = 0;
+	uint64_t check = 0;
+
+	Result(size_t tokens, uint64_t check = 0) : tokens(tokens), check(check) {}
+
+	bool operator==(const Result& other) const { return tokens == other.tokens && check == other.check; }
+	bool operator!=(const Result& other) const { return !(*this == other); }
+};
+
+// The check value of a float result: its bits, which drivers applying the same operations in the same
+// order agree on
+inline uint64_t check_of(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+// FNV-1a step, for check values over a sequence (e.g. the nodes of a tree, in the order they were built)
+constexpr uint64_t hash_seed = 14695981039346656037ull;
+
+inline uint64_t hash(uint64_t hash, uint64_t value) {
+	for (int byte = 0; byte < 8; byte++, value >>= 8) hash = (hash ^ (value & 0xff)) * 1099511628211ull;
+	return hash;
+}
+
+// One implementation of a phase. 'run' processes inputs[index].
+struct Driver {
+	std::string phase;
+	std::string name;
+	bool is_default; // measured without --compare
+	std::function<Result(size_t index)> run;
+};
+
+struct Measurement {
+	std::string workload, phase, driver;
+	size_t tokens = 0;
+	size_t bytes = 0;
+	size_t runs = 0;
+	size_t failures = 0;      // inputs rejected (of a well-formed workload), or whose result differs from the reference driver's
+	size_t allocations = 0;
+	size_t allocated_bytes = 0;
+	double seconds = 0;
+	std::vector<double> latencies_us; // sorted
+	std::vector<Result> results;      // per input, of the first round
+};
+
+// 'reference' is the measurement of the phase's reference driver, or nullptr for the reference itself
+inline Measurement measure(const Workload& workload, const Driver& driver, size_t rounds, const Measurement* reference) {
+	Measurement measurement;
+	measurement.workload = workload.name;
+	measurement.phase = driver.phase;
+	measurement.driver = driver.name;
+	measurement.latencies_us.reserve(workload.inputs.size() * rounds);
+	measurement.results.reserve(workload.inputs.size());
+
+	auto allocations_before = allocations;
+	auto allocated_bytes_before = allocated_bytes;
+	for (size_t round = 0; round < rounds; round++) {
+		for (size_t index = 0; index < workload.inputs.size(); index++) {
+			auto start = Clock::now();
+			auto result = driver.run(index);
+			std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+
+			measurement.latencies_us.push_back(elapsed.count());
+			measurement.seconds += elapsed.count() / 1e6;
+			measurement.tokens += result.tokens;
+			measurement.bytes += workload.inputs[index].size();
+			measurement.failures += (workload.well_formed && result.tokens == 0) || (reference && result != reference->results[index]);
+			++measurement.runs;
+			if (round == 0) measurement.results.push_back(result);
+		}
+	}
+	measurement.allocations = allocations - allocations_before;
+	measurement.allocated_bytes = allocated_bytes - allocated_bytes_before;
+
+	std::sort(measurement.latencies_us.begin(), measurement.latencies_us.end());
+	return measurement;
+}
+
+inline double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) return 0;
+	return sorted[static_cast<size_t>(p / 100 * (sorted.size() - 1))];
+}
+
+inline void print_header() {
+	std::cout << std::left << std::setw(12) << "workload" << std::setw(10) << "phase" << std::setw(11) << "driver"
+		<< std::right << std::setw(10) << "Mtok/s" << std::setw(9) << "MB/s" << std::setw(10) << "p50 us"
+		<< std::setw(10) << "p90 us" << std::setw(10) << "p99 us" << std::setw(10) << "max us"
+		<< std::setw(13) << "allocs/input" << std::setw(9) << "relative" << std::setw(8) << "failed" << "\n";
+}
+
+// 'reference' is the first driver measured for the same workload and phase
+inline void print(const Measurement& measurement, const Measurement& reference) {
+	auto per_second = [&measurement](size_t count) { return measurement.seconds > 0 ? count / measurement.seconds / 1e6 : 0.0; };
+	auto& latencies = measurement.latencies_us;
+	std::cout << std::left << std::setw(12) << measurement.workload << std::setw(10) << measurement.phase
+		<< std::setw(11) << measurement.driver << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(10) << per_second(measurement.tokens) << std::setw(9) << per_second(measurement.bytes)
+		<< std::setprecision(1) << std::setw(10) << percentile(latencies, 50) << std::setw(10) << percentile(latencies, 90)
+		<< std::setw(10) << percentile(latencies, 99) << std::setw(10) << (latencies.empty() ? 0 : latencies.back())
+		<< std::setw(13) << (measurement.runs ? static_cast<double>(measurement.allocations) / measurement.runs : 0)
+		<< std::setprecision(2) << std::setw(8) << (measurement.seconds > 0 ? reference.seconds / measurement.seconds : 0) << "x"
+		<< std::setw(8) << measurement.failures << "\n" << std::defaultfloat;
+}
+
+// Measure every selected driver on every selected workload, and print the results. 'drivers_for'
+// prepares whatever a workload's drivers need (e.g. its pre-scanned tokens) and returns them.
+inline void run(const std::vector<Workload>& workloads, const std::function<std::vector<Driver>(const Workload&)>& drivers_for,
+	const Options& options)
+{
+	print_header();
+	for (auto& workload : workloads) {
+		if (!options.workload.empty() && options.workload != workload.name) continue;
+
+		std::vector<Measurement> measurements;
+		for (auto& driver : drivers_for(workload)) {
+			if (!options.compare && !driver.is_default) continue;
+
+			auto reference = std::find_if(measurements.begin(), measurements.end(), [&driver](const Measurement& previous) {
+				return previous.phase == driver.phase;
+			});
+			auto measurement = measure(workload, driver, options.rounds, reference == measurements.end() ? nullptr : &*reference);
+			print(measurement, reference == measurements.end() ? measurement : *reference);
+			measurements.push_back(std::move(measurement));
+		}
+	}
+}
+
+inline void print_usage(const char* program, const std::string& workloads) {
+	std::cout << "usage: " << program << " [-n <inputs>] [-s <size>] [-r <rounds>] [--seed <seed>]\n"
+		<< std::string(std::string("usage: ").size() + std::string(program).size(), ' ')
+		<< " [--workload <name>] [--compare]\n\n"
+		<< "workloads: " << workloads << "\n";
+}
+
+inline bool parse_options(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+		if (option == "--compare") {
+			options.compare = true;
+			continue;
+		}
+		if (i + 1 >= argc) return false;
+
+		if (option == "--workload") {
+			options.workload = argv[++i];
+			continue;
+		}
+		auto value = std::strtoul(argv[++i], nullptr, 10);
+		if (option == "--seed") options.seed = static_cast<unsigned>(value);
+		else if (value == 0) return false;
+		else if (option == "-n") options.inputs = value;
+		else if (option == "-s") options.size = value;
+		else if (option == "-r") options.rounds = value;
+		else return false;
+	}
+	return true;
+}
+
+} // namespace bench
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../parentheses/validator.h"
+#include "../parentheses/constant-validator.h"
+#include "bench-harness.h"
+
+// generated by --emit-recognizer at build time, with its own TokenType
+namespace recognizer {
+#include "paren-recognizer.h"
+}
+
+// Runtime benchmark of the 'parentheses' scanner and parser.
+//
+// Phases: 'scan' turns input text into tokens, 'parse' recognizes the scanned tokens. Drivers:
+//   scanner    scan() of validator.h
+//   validator  parse() of validator.h, as used by the REPL
+//   vector     the same table walk, with one lookup per action and a state stack kept across inputs
+//   constexpr  Tables::parse() of runtime/constexpr-tables.h, over tables the compiler builds from
+//              the grammar of constant-validator.h
+//   recognizer recognize() of the recognizer generated at build time by --emit-recognizer
+
+// '((((...))))', 'depth' pairs deep
+static std::string nested(size_t depth) {
+	return std::string(depth, '(') + std::string(depth, ')');
+}
+
+// '()()()...', 'pairs' pairs long
+static std::string sequence(size_t pairs) {
+	std::string input;
+	for (size_t i = 0; i < pairs; i++) input += "()";
+	return input;
+}
+
+// 'pairs' pairs, in a list of nested pairs of random depth
+static std::string random_pairs(size_t pairs, std::mt19937& random) {
+	std::string input;
+	while (pairs > 0) {
+		auto depth = std::min(pairs, std::uniform_int_distribution<size_t>(1, 16)(random));
+		input += nested(depth);
+		pairs -= depth;
+	}
+	return input;
+}
+
+static bool vector_parse(const std::vector<TokenType>& tokens, std::vector<size_t>& states) {
+	states.clear();
+	states.push_back(0);
+
+	for (size_t i = 0; i < tokens.size();) {
+		auto action_entry = actionTable.find(std::make_pair(states.back(), tokens[i]));
+		if (action_entry == actionTable.end()) return false;
+
+		auto& action = action_entry->second;
+		if (action.type == ActionType::REDUCE) {
+			states.resize(states.size() - reduce_info[action.value].second);
+			auto goto_entry = gotoTable.find(std::make_pair(states.back(), reduce_info[action.value].first));
+			if (goto_entry == gotoTable.end()) return false;
+			states.push_back(goto_entry->second);
+		}
+		else if (action.type == ActionType::SHIFT) {
+			states.push_back(action.value);
+			++i;
+		}
+		else if (action.type == ActionType::ACCEPT) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char** argv) {
+	bench::Options options;
+	if (!bench::parse_options(argc, argv, options)) {
+		bench::print_usage(argv[0], "nested, sequence, random");
+		return 1;
+	}
+
+	std::mt19937 random(options.seed);
+	std::vector<bench::Workload> workloads{ { "nested", {} }, { "sequence", {} }, { "random", {} } };
+	for (size_t i = 0; i < options.inputs; i++) {
+		workloads[0].inputs.push_back(nested(options.size));
+		workloads[1].inputs.push_back(sequence(options.size));
+		workloads[2].inputs.push_back(random_pairs(options.size, random));
+	}
+
+	std::vector<std::vector<TokenType>> scanned;
+	std::vector<TokenType> tokens;
+	std::string errors;
+	std::vector<size_t> states;
+	std::vector<uint32_t> constexpr_states;
+	std::vector<recognizer::State> recognizer_states;
+	constexpr auto& paren_tables = constexpr_tables::tables<parentheses_grammar>;
+
+	auto drivers_for = [&](const bench::Workload& workload) {
+		scanned.assign(workload.inputs.size(), {});
+		for (size_t i = 0; i < workload.inputs.size(); i++) {
+			scan(workload.inputs[i], scanned[i], errors);
+		}
+
+		std::vector<bench::Driver> drivers{
+			{ "scan", "scanner", true, [&](size_t index) {
+				tokens.clear();
+				return scan(workload.inputs[index], tokens, errors) ? tokens.size() : 0;
+			} },
+			{ "parse", "validator", true, [&](size_t index) {
+				return parse(scanned[index]) ? scanned[index].size() : 0;
+			} },
+			{ "parse", "vector", false, [&](size_t index) {
+				return vector_parse(scanned[index], states) ? scanned[index].size() : 0;
+			} },
+			{ "parse", "constexpr", false, [&](size_t index) {
+				auto& input = scanned[index];
+				if (constexpr_states.size() <= input.size()) constexpr_states.resize(input.size() + 1);
+				return paren_tables.parse(input.data(), input.size(), constexpr_states, [](size_t) {}, [](uint32_t) {}) ? input.size() : 0;
+			} },
+			{ "parse", "recognizer", false, [&](size_t index) {
+				auto& input = scanned[index];
+				return recognizer::recognize(input.data(), input.size(), recognizer_states).valid ? input.size() : 0;
+			} },
+		};
+		return drivers;
+	};
+
+	bench::run(workloads, drivers_for, options);
+	return 0;
+}
@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Scaling benchmark for the parser generator.
+//
+// Generates families of synthetic grammars at increasing sizes, runs parsegen on each with
+// '--stats', and reports the time taken by build_cc and build_tables (the fastest of
+// 'repeat' runs), along with the number of states and table entries. '--record' writes
+// the results to a baseline file; '--compare' checks them against one, and fails if a
+// phase got slower than the baseline by more than the threshold.
+//
+// The smallest grammar of every family has a known number of states. A run or a baseline
+// that disagrees comes from broken tables, and is neither recorded nor compared against.
+
+#ifndef PARSEGEN_EXECUTABLE
+#define PARSEGEN_EXECUTABLE "./parsegen"
+#endif
+
+namespace fs = std::filesystem;
+
+struct Family {
+	const char* name;
+	std::string (*grammar)(size_t size);
+	std::vector<size_t> sizes;
+	size_t reference_states; // states of the canonical collection of the grammar of sizes[0]
+};
+
+struct Result {
+	std::string family;
+	size_t size;
+	size_t states = 0;
+	size_t action_entries = 0;
+	size_t goto_entries = 0;
+	double build_cc = 0;
+	double build_tables = 0;
+};
+
+// 'size' binary operators, each on its own precedence level, over an ambiguous expression grammar
+static std::string precedence_levels(size_t size) {
+	std::stringstream grammar;
+	grammar << "t_EOF\n";
+	for (size_t i = 1; i <= size; i++) grammar << "t_OP" << i << " " << i << " l\n";
+	grammar << "t_ID\nt_LP\nt_RP\n\n"
+		"Goal > Expr\n"
+		"Expr > t_ID\n"
+		"Expr > t_LP Expr t_RP\n";
+	for (size_t i = 1; i <= size; i++) grammar << "Expr > Expr t_OP" << i << " Expr\n";
+	return grammar.str();
+}
+
+// a list of items, each introduced by one of 'size' keywords
+static std::string alternation(size_t size) {
+	std::stringstream grammar;
+	grammar << "t_EOF\nt_ID\nt_SEMI\n";
+	for (size_t i = 1; i <= size; i++) grammar << "t_KW" << i << "\n";
+	grammar << "\n"
+		"Goal > List\n"
+		"List > List Item\n"
+		"List > Item\n";
+	for (size_t i = 1; i <= size; i++) grammar << "Item > t_KW" << i << " t_ID t_SEMI\n";
+	return grammar.str();
+}
+
+// 'size' levels of an unambiguous (stratified) expression grammar, chained by unit productions
+static std::string nesting_chain(size_t size) {
+	std::stringstream grammar;
+	grammar << "t_EOF\nt_ID\nt_LP\nt_RP\n";
+	for (size_t i = 0; i < size; i++) grammar << "t_OP" << i << "\n";
+	grammar << "\n"
+		"Goal > Level0\n";
+	for (size_t i = 0; i < size; i++) {
+		grammar << "Level" << i << " > Level" << i << " t_OP" << i << " Level" << i + 1 << "\n"
+			<< "Level" << i << " > Level" << i + 1 << "\n";
+	}
+	grammar << "Level" << size << " > t_ID\n"
+		<< "Level" << size << " > t_LP Level0 t_RP\n";
+	return grammar.str();
+}
+
+// C-like statements and expressions, with 'size' additional 'keyword (condition) statement' forms
+static std::string statements(size_t size) {
+	std::stringstream grammar;
+	grammar << "t_EOF\nt_ASSIGN 1 r\nt_EQ 2 l\nt_PLUS 3 l\nt_MINUS 3 l\nt_TIMES 4 l\n"
+		"t_ID\nt_NUM\nt_LP\nt_RP\nt_LB\nt_RB\nt_SEMI\nt_COMMA\nt_IF\nt_ELSE\nt_WHILE\nt_RETURN\n";
+	for (size_t i = 1; i <= size; i++) grammar << "t_KW" << i << "\n";
+	grammar << "\n"
+		"Program > Stmts\n"
+		"Stmts > Stmts Stmt\n"
+		"Stmts > Stmt\n"
+		"Stmt > t_LB Stmts t_RB\n"
+		"Stmt > t_LB t_RB\n"
+		"Stmt > t_IF t_LP Expr t_RP Stmt\n"
+		"Stmt > t_IF t_LP Expr t_RP Stmt t_ELSE Stmt\n"
+		"Stmt > t_WHILE t_LP Expr t_RP Stmt\n"
+		"Stmt > t_RETURN Expr t_SEMI\n"
+		"Stmt > Expr t_SEMI\n";
+	for (size_t i = 1; i <= size; i++) grammar << "Stmt > t_KW" << i << " t_LP Expr t_RP Stmt\n";
+	grammar << "Expr > t_ID t_ASSIGN Expr\n"
+		"Expr > Expr t_EQ Expr\n"
+		"Expr > Expr t_PLUS Expr\n"
+		"Expr > Expr t_MINUS Expr\n"
+		"Expr > Expr t_TIMES Expr\n"
+		"Expr > t_MINUS Expr 5\n"
+		"Expr > t_ID t_LP Args t_RP\n"
+		"Expr > t_ID\n"
+		"Expr > t_NUM\n"
+		"Expr > t_LP Expr t_RP\n"
+		"Args > Args t_COMMA Expr\n"
+		"Args > Expr\n";
+	return grammar.str();
+}
+
+// The reference state counts were checked against the tables runtime/constexpr-tables.h builds from
+// the same grammars. Those only keep the states reachable once conflicts are resolved: 'statements'
+// has 4 states more, reached only through the SHIFTs its precedences drop.
+static const std::vector<Family> families {
+	{ "precedence", precedence_levels, { 1, 2, 4, 8 }, 14 },
+	{ "alternation", alternation, { 4, 8, 16, 32, 64 }, 16 },
+	{ "nesting", nesting_chain, { 2, 4, 8, 16 }, 22 },
+	{ "statements", statements, { 0, 2, 4, 8 }, 153 },
+};
+
+// The number following '"key": ' (after 'from', if given) in a --stats report
+static double stats_value(const std::string& stats, const std::string& key, const std::string& from = "") {
+	auto position = from.empty() ? 0 : stats.find(from);
+	if (position == std::string::npos) return -1;
+	position = stats.find("\"" + key + "\": ", position);
+	if (position == std::string::npos) return -1;
+	return std::strtod(stats.c_str() + position + key.size() + 4, nullptr);
+}
+
+static bool run_parsegen(const std::string& parsegen, const fs::path& directory, const std::string& grammar_text, Result& result) {
+	auto grammar = directory / "grammar.txt";
+	auto output = directory / "parse-tables.h";
+	auto stats = directory / "stats.json";
+	std::ofstream(grammar, std::ios::out) << grammar_text;
+	fs::remove(stats);
+
+#ifdef _WIN32
+	const char* null_device = "NUL";
+#else
+	const char* null_device = "/dev/null";
+#endif
+	auto command = "\"" + parsegen + "\" \"" + grammar.string() + "\" \"" + output.string() +
+		"\" --stats \"" + stats.string() + "\" > " + null_device;
+	if (std::system(command.c_str()) != 0) return false;
+
+	std::ifstream file(stats, std::ios::in);
+	std::stringstream ss;
+	ss << file.rdbuf();
+	auto report = ss.str();
+
+	auto build_cc = stats_value(report, "seconds", "\"name\": \"build_cc\"");
+	auto build_tables = stats_value(report, "seconds", "\"name\": \"build_tables\"");
+	if (build_cc < 0 || build_tables < 0) return false;
+
+	result.states = static_cast<size_t>(stats_value(report, "states"));
+	result.action_entries = static_cast<size_t>(stats_value(report, "action_entries"));
+	result.goto_entries = static_cast<size_t>(stats_value(report, "goto_entries"));
+	result.build_cc = build_cc;
+	result.build_tables = build_tables;
+	return true;
+}
+
+static void write_results(std::ostream& out, const std::vector<Result>& results) {
+	out << "# family size states action_entries goto_entries build_cc_seconds build_tables_seconds\n";
+	for (auto& result : results) {
+		out << result.family << " " << result.size << " " << result.states << " " << result.action_entries << " "
+			<< result.goto_entries << " " << result.build_cc << " " << result.build_tables << "\n";
+	}
+}
+
+static bool read_results(const std::string& path, std::vector<Result>& results) {
+	std::ifstream file(path, std::ios::in);
+	if (!file.is_open()) return false;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		std::stringstream fields(line);
+		Result result;
+		if (fields >> result.family >> result.size >> result.states >> result.action_entries
+			>> result.goto_entries >> result.build_cc >> result.build_tables)
+		{
+			results.push_back(result);
+		}
+	}
+	return true;
+}
+
+// Whether the smallest grammar of every family in 'results' has its reference number of states
+static bool check_reference_states(const std::vector<Result>& results, const std::string& source) {
+	bool valid = true;
+	for (auto& family : families) {
+		auto smallest = std::find_if(results.begin(), results.end(), [&family](const Result& result) {
+			return result.family == family.name && result.size == family.sizes[0];
+		});
+		if (smallest == results.end() || smallest->states == family.reference_states) continue;
+
+		std::cout << source << ": the " << family.name << " grammar of size " << smallest->size << " has " << smallest->states
+			<< " states instead of " << family.reference_states << ", so its tables are wrong.\n";
+		valid = false;
+	}
+	return valid;
+}
+
+// Differences below this are timer and scheduling noise, whatever their ratio
+constexpr double noise_seconds = 0.002;
+
+static bool regressed(double current, double baseline, double threshold) {
+	return current - baseline > noise_seconds && current > baseline * (1 + threshold);
+}
+
+static size_t compare_results(const std::vector<Result>& results, const std::vector<Result>& baseline, double threshold) {
+	size_t regressions = 0;
+	std::cout << "\n" << std::left << std::setw(14) << "family" << std::setw(6) << "size"
+		<< std::setw(14) << "build_cc" << std::setw(14) << "build_tables" << "\n";
+	for (auto& result : results) {
+		auto base = std::find_if(baseline.begin(), baseline.end(), [&result](const Result& candidate) {
+			return candidate.family == result.family && candidate.size == result.size;
+		});
+		if (base == baseline.end()) continue;
+
+		auto ratio = [](double current, double previous) {
+			std::stringstream out;
+			out << std::fixed << std::setprecision(2) << (previous > 0 ? current / previous : 0) << "x";
+			return out.str();
+		};
+		bool cc_regressed = regressed(result.build_cc, base->build_cc, threshold);
+		bool tables_regressed = regressed(result.build_tables, base->build_tables, threshold);
+		std::cout << std::setw(14) << result.family << std::setw(6) << result.size
+			<< std::setw(14) << ratio(result.build_cc, base->build_cc) + (cc_regressed ? " !" : "")
+			<< std::setw(14) << ratio(result.build_tables, base->build_tables) + (tables_regressed ? " !" : "");
+		if (result.states != base->states || result.action_entries != base->action_entries || result.goto_entries != base->goto_entries) {
+			std::cout << "tables differ: " << base->states << "/" << base->action_entries << "/" << base->goto_entries
+				<< " -> " << result.states << "/" << result.action_entries << "/" << result.goto_entries;
+		}
+		std::cout << "\n";
+		regressions += cc_regressed + tables_regressed;
+	}
+	return regressions;
+}
+
+static inline void print_usage() {
+	std::cout << "usage: ./bench_parsegen [--parsegen <path/to/parsegen>] [--family <name>] [--repeat <count>]\n"
+		"                        [--record <path/to/baseline>] [--compare <path/to/baseline>] [--threshold <fraction>]\n\n"
+		"families: precedence, alternation, nesting, statements\n";
+}
+
+int main(int argc, char** argv) {
+	std::string parsegen = PARSEGEN_EXECUTABLE;
+	std::string family_filter;
+	std::string record_path;
+	std::string compare_path;
+	size_t repeat = 3;
+	double threshold = 0.10;
+
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+		if (i + 1 >= argc) {
+			print_usage();
+			return 1;
+		}
+
+		if (option == "--parsegen") parsegen = argv[++i];
+		else if (option == "--family") family_filter = argv[++i];
+		else if (option == "--record") record_path = argv[++i];
+		else if (option == "--compare") compare_path = argv[++i];
+		else if (option == "--repeat") repeat = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+		else if (option == "--threshold") threshold = std::strtod(argv[++i], nullptr);
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	std::vector<Result> baseline;
+	if (!compare_path.empty() && !read_results(compare_path, baseline)) {
+		std::cout << "Unable to open " << compare_path << " file.\n";
+		return -1;
+	}
+	if (!check_reference_states(baseline, compare_path)) {
+		std::cout << "Rejecting the baseline; record it again with a working parsegen.\n";
+		return -1;
+	}
+
+	auto directory = fs::temp_directory_path() / "bench-parsegen";
+	fs::create_directories(directory);
+
+	std::vector<Result> results;
+	std::cout << std::left << std::setw(14) << "family" << std::setw(6) << "size" << std::setw(8) << "states"
+		<< std::setw(10) << "actions" << std::setw(8) << "gotos" << std::setw(14) << "build_cc s" << "build_tables s\n";
+	for (auto& family : families) {
+		if (!family_filter.empty() && family_filter != family.name) continue;
+
+		for (auto size : family.sizes) {
+			auto grammar = family.grammar(size);
+			Result best;
+			for (size_t run = 0; run < repeat; run++) {
+				Result result;
+				if (!run_parsegen(parsegen, directory, grammar, result)) {
+					std::cout << "parsegen failed on the " << family.name << " grammar of size " << size
+						<< " (grammar left in " << (directory / "grammar.txt").string() << ")\n";
+					return -1;
+				}
+				if (run == 0 || result.build_cc + result.build_tables < best.build_cc + best.build_tables) best = result;
+			}
+			best.family = family.name;
+			best.size = size;
+			results.push_back(best);
+
+			std::cout << std::setw(14) << best.family << std::setw(6) << best.size << std::setw(8) << best.states
+				<< std::setw(10) << best.action_entries << std::setw(8) << best.goto_entries
+				<< std::setw(14) << best.build_cc << best.build_tables << std::endl;
+		}
+	}
+	fs::remove_all(directory);
+
+	if (!check_reference_states(results, parsegen)) {
+		std::cout << "Not recording or comparing these results.\n";
+		return -1;
+	}
+
+	if (!record_path.empty()) {
+		std::ofstream file(record_path, std::ios::out);
+		if (!file.is_open()) {
+			std::cout << "Unable to open " << record_path << " file.\n";
+			return -1;
+		}
+		write_results(file, results);
+		std::cout << "\nResults recorded to '" << record_path << "'.\n";
+	}
+
+	if (!baseline.empty()) {
+		auto regressions = compare_results(results, baseline, threshold);
+		std::cout << "\n" << regressions << " phase timings regressed by more than " << threshold * 100 << "% ('!').\n";
+		if (regressions) return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "../runtime/constexpr-tables.h"
+
+// Evaluation of constant expressions by the compiler. The 'mathematical expressions' grammar is built
+// into tables at compile time (runtime/constexpr-tables.h), and constant_expression() scans, parses and
+// evaluates a string literal with them, with the semantics of scan() and parse() of evaluator.h:
+//
+//   constexpr auto v = constant_expression("2*(3+4)");
+//   static_assert(v.valid, "malformed expression");   // v.value == 14
+//
+// Nothing is left to do at runtime. Like any constexpr function, it can be called at runtime too.
+// A division by zero is not a constant expression, and stops the compilation.
+
+// expr-grammar.txt
+static constexpr char expression_grammar[] =
+	"t_EOF\n"
+	"t_PLUS 1 l\n"
+	"t_MINUS 1 l\n"
+	"t_TIMES 2 l\n"
+	"t_DIVIDE 2 l\n"
+	"t_NUMBER 4\n"
+	"t_LP\n"
+	"t_RP\n"
+	"\n"
+	"Statement > Expression\n"
+	"Expression > t_NUMBER\n"
+	"Expression > Grouping\n"
+	"Expression > Add\n"
+	"Expression > Sub\n"
+	"Expression > Mul\n"
+	"Expression > Div\n"
+	"Expression > Unary\n"
+	"Grouping > t_LP Expression t_RP 2\n"
+	"Add > Expression t_PLUS Expression\n"
+	"Sub > Expression t_MINUS Expression\n"
+	"Mul > Expression t_TIMES Expression\n"
+	"Div > Expression t_DIVIDE Expression\n"
+	"Unary > t_MINUS Expression 3\n";
+
+struct ConstantExpression {
+	bool valid = false;
+	float value = 0;
+	size_t error_offset = 0; // where scanning or parsing stopped, when not valid
+};
+
+// The tables, and what the scanner and the semantic actions need of them
+struct ConstantExpressionGrammar {
+	static constexpr auto& tables = constexpr_tables::tables<expression_grammar>;
+	static constexpr char operator_characters[] = { '+', '-', '*', '/', '(', ')' };
+	static constexpr uint32_t operator_tokens[] = { tables.terminal("t_PLUS"), tables.terminal("t_MINUS"), tables.terminal("t_TIMES"),
+		tables.terminal("t_DIVIDE"), tables.terminal("t_LP"), tables.terminal("t_RP") };
+	static constexpr uint32_t number_token = tables.terminal("t_NUMBER");
+	static constexpr uint32_t end_token = tables.terminal("t_EOF");
+
+	enum Operation { NONE, NEGATE, ADD, SUB, MUL, DIV };
+	static constexpr auto operations = [] {
+		constexpr std::string_view names[] = { "", "Unary", "Add", "Sub", "Mul", "Div" };
+		std::array<Operation, tables.rule_count()> operations{};
+		for (uint32_t rule = 0; rule < tables.rule_count(); rule++) {
+			for (int operation = NEGATE; operation <= DIV; operation++) {
+				if (tables.non_terminal_name(tables.rule_lhs(rule)) == names[operation]) operations[rule] = static_cast<Operation>(operation);
+			}
+		}
+		return operations;
+	}();
+};
+
+template<size_t N>
+constexpr ConstantExpression constant_expression(const char (&input)[N]) {
+	using Grammar = ConstantExpressionGrammar;
+
+	// scan(): one token per character at most, and t_EOF. Numbers are read as std::stoi reads them.
+	std::array<uint32_t, N + 1> tokens{};
+	std::array<size_t, N + 1> offsets{};
+	std::array<float, N + 1> numbers{};
+	size_t count = 0;
+	std::string_view text(input, N - 1);
+	for (size_t i = 0; i < text.size(); i++) {
+		auto c = text[i];
+		if (c == ' ' || c == '\r' || c == '\t' || c == '\n') continue;
+
+		offsets[count] = i;
+		bool found = false;
+		for (size_t symbol = 0; symbol < sizeof(Grammar::operator_characters) && !found; symbol++) {
+			if (c != Grammar::operator_characters[symbol]) continue;
+			tokens[count++] = Grammar::operator_tokens[symbol];
+			found = true;
+		}
+		if (found) continue;
+
+		if (c < '0' || c > '9') return { false, 0, i };
+		long long number = 0;
+		for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++) {
+			number = number * 10 + (text[i] - '0');
+			if (number > 2147483647LL) return { false, 0, offsets[count] };
+		}
+		i--;
+		numbers[count] = static_cast<float>(number);
+		tokens[count++] = Grammar::number_token;
+	}
+	offsets[count] = text.size();
+	tokens[count++] = Grammar::end_token;
+
+	// parse(), with the value stack and the semantic actions of reduce()
+	std::array<uint32_t, N + 2> states{};
+	std::array<float, N + 1> values{};
+	size_t depth = 0, position = 0;
+	auto on_shift = [&](size_t shifted) {
+		position = shifted + 1;
+		if (tokens[shifted] == Grammar::number_token) values[depth++] = numbers[shifted];
+	};
+	auto on_reduce = [&](uint32_t rule) {
+		auto operation = Grammar::operations[rule];
+		if (operation == Grammar::NONE) return;
+		if (operation == Grammar::NEGATE) {
+			values[depth - 1] = -values[depth - 1];
+			return;
+		}
+
+		auto rhs = values[--depth];
+		auto& result = values[depth - 1];
+		if (operation == Grammar::ADD) result += rhs;
+		else if (operation == Grammar::SUB) result -= rhs;
+		else if (operation == Grammar::MUL) result *= rhs;
+		else result /= rhs;
+	};
+	if (!Grammar::tables.parse(tokens.data(), count, states, on_shift, on_reduce)) return { false, 0, offsets[position] };
+	return { true, values[0], 0 };
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <stack>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parse-tables.h"
+#include "../runtime/parse-profile.h"
+
+// Scanner and table-driven evaluator for the 'mathematical expressions' grammar.
+// Shared by the REPL interpreter and the evaluation server. The parse tables are
+// only ever read through find(), so any number of threads may evaluate concurrently.
+
+static bool is_whitespace(char c) {
+	return (c == ' ' || c == '\r' || c == '\t');
+}
+
+static bool is_digit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+struct Token {
+	TokenType type;
+	std::string value;
+};
+
+// Scan 'input' into 'output', terminated by a t_EOF token. Diagnostics for unexpected
+// characters are appended to 'errors'.
+static bool scan(std::string_view input, std::vector<Token>& output, std::string& errors) {
+	bool scan_error = false;
+	size_t start = 0;
+
+	for (size_t i = 0; i < input.size(); i++) {
+		if (input[i] == '\n' ||
+			is_whitespace(input[i]))
+		{
+			start = i + 1;
+			continue;
+		}
+
+		switch (input[i]) {
+		case '(': {
+			Token token{ TokenType::t_LP, std::string(input.substr(start, 1)) };
+			output.push_back(token);
+			start = i + 1;
+			break;
+		}
+		case ')': {
+			Token token{ TokenType::t_RP, std::string(input.substr(start, 1)) };
+			output.push_back(token);
+			start = i + 1;
+			break;
+		}
+		case '+': {
+			Token token{ TokenType::t_PLUS, std::string(input.substr(start, 1)) };
+			output.push_back(token);
+			start = i + 1;
+			break;
+		}
+		case '-': {
+			Token token{ TokenType::t_MINUS, std::string(input.substr(start, 1)) };
+			output.push_back(token);
+			start = i + 1;
+			break;
+		}
+		case '*': {
+			Token token{ TokenType::t_TIMES, std::string(input.substr(start, 1)) };
+			output.push_back(token);
+			start = i + 1;
+			break;
+		}
+		case '/': {
+			Token token{ TokenType::t_DIVIDE, std::string(input.substr(start, 1)) };
+			output.push_back(token);
+			start = i + 1;
+			break;
+		}
+		default:
+			if (is_digit(input[i])) {
+				while (i < input.size() && is_digit(input[i])) {
+					++i;
+				}
+				Token token{ TokenType::t_NUMBER, std::string(input.substr(start, i - start)) };
+				i--;
+				output.push_back(token);
+			}
+			else {
+				errors += "Unexpected token '";
+				errors += input[i];
+				errors += "'\n";
+				scan_error = true;
+			}
+			start = i + 1;
+		}
+	}
+	if (scan_error) {
+		return false;
+	}
+	Token token{ TokenType::t_EOF, "$" };
+	output.push_back(token);
+	return true;
+}
+
+// Pop 'pop_count' states, push the goto state for reduce_info[index], and apply the rule's
+// semantic action to the value stack.
+static bool reduce(size_t index, size_t pop_count, std::stack<size_t>& states, std::stack<float>& values) {
+	PARSEGEN_PROFILE_REDUCE(index);
+	while (pop_count--) {
+		states.pop();
+	}
+	auto reduce_symbol = reduce_info[index].first;
+	auto goto_entry = gotoTable.find(std::make_pair(states.top(), reduce_symbol));
+	if (goto_entry == gotoTable.end()) {
+		PARSEGEN_PROFILE_MISS(states.top());
+		return false;
+	}
+	states.push(goto_entry->second);
+	PARSEGEN_PROFILE_DEPTH(states.size());
+
+	if (reduce_symbol == "Add") {
+		auto rhs = values.top();
+		values.pop();
+		auto lhs = values.top();
+		values.pop();
+		values.push(lhs + rhs);
+	}
+	else if (reduce_symbol == "Sub") {
+		auto rhs = values.top();
+		values.pop();
+		auto lhs = values.top();
+		values.pop();
+		values.push(lhs - rhs);
+	}
+	else if (reduce_symbol == "Mul") {
+		auto rhs = values.top();
+		values.pop();
+		auto lhs = values.top();
+		values.pop();
+		values.push(lhs * rhs);
+	}
+	else if (reduce_symbol == "Div") {
+		auto rhs = values.top();
+		values.pop();
+		auto lhs = values.top();
+		values.pop();
+		values.push(lhs / rhs);
+	}
+	else if (reduce_symbol == "Unary") {
+		auto val = values.top();
+		values.pop();
+		values.push(-val);
+	}
+	return true;
+}
+
+static bool parse(const std::vector<Token>& tokens, float& output) {
+	std::stack<size_t> states;
+	std::stack<float> values;
+
+	states.push(0);
+	auto state = static_cast<size_t>(0);
+
+	for (size_t i = 0; i < tokens.size();) {
+		state = states.top();
+		PARSEGEN_PROFILE_LOOKUP(state);
+
+		// states with a default reduction REDUCE without looking at the next token
+		auto default_reduction = default_reductions[state];
+		if (default_reduction != NO_DEFAULT_REDUCTION) {
+			if (!reduce(default_reduction, reduce_info[default_reduction].second, states, values)) {
+				return false;
+			}
+			continue;
+		}
+
+		auto action_entry = actionTable.find(std::make_pair(state, tokens[i].type));
+		if (action_entry == actionTable.end()) {
+			PARSEGEN_PROFILE_MISS(state);
+			return false;
+		}
+
+		const Action& action = action_entry->second;
+
+		if (action.type == ActionType::REDUCE) {
+			if (!reduce(action.value, reduce_info[action.value].second, states, values)) {
+				return false;
+			}
+		}
+		else if (action.type == ActionType::SHIFT || action.type == ActionType::SHIFT_REDUCE) {
+			PARSEGEN_PROFILE_SHIFT(state, tokens[i].type);
+			// Only SHIFT actions proceed to the next symbol
+			if (tokens[i].type == t_NUMBER) {
+				values.push(std::stoi(tokens[i].value));
+			}
+			++i;
+
+			if (action.type == ActionType::SHIFT) {
+				states.push(action.value);
+				PARSEGEN_PROFILE_DEPTH(states.size());
+			}
+			// the shifted state is never pushed, so there is one state less to pop
+			else if (!reduce(action.value, reduce_info[action.value].second - 1, states, values)) {
+				return false;
+			}
+		}
+		else if (action.type == ActionType::ACCEPT) {
+			output = values.top();
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server-protocol.h"
+
+// Client and load generator for the expression evaluation server.
+//
+// With '-e', each given expression is evaluated and its result printed. Otherwise
+// every connection keeps 'pipeline-depth' requests in flight until it has sent
+// 'requests' of them, and the combined throughput and latency percentiles are reported.
+
+using Clock = std::chrono::steady_clock;
+
+struct Sample {
+	std::string expression;
+	std::string expected; // empty when unknown (expressions read from a file)
+};
+
+static const std::vector<Sample> builtin_samples {
+	{ "1+2*3", "7" }, { "(1+2)*3", "9" }, { "-4/2+10", "8" },
+	{ "2*(3+4)-5/5", "13" }, { "((((1))))+(((2)))", "3" }, { "8/(3-1)*-2", "-8" },
+	{ "1-2-3-4-5-6-7-8-9", "-43" }, { "2*3*4*5/6/2", "10" }, { "-(-(-(7)))", "-7" },
+	{ "100/8", "12.5" }, { "(((1+2)*(3+4))-((5-6)*(7+8)))/2", "18" }, { "9", "9" }
+};
+
+struct Result {
+	std::vector<double> latencies_us;
+	size_t errors = 0;
+	size_t mismatches = 0;
+	bool failed = false;
+};
+
+static int connect_to(const std::string& socket_path) {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(address.sun_path)) return -1;
+	std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static bool send_all(int fd, const std::string& data) {
+	size_t written = 0;
+	while (written < data.size()) {
+		auto n = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		written += n;
+	}
+	return true;
+}
+
+// Reads responses into 'in' and calls 'on_response' for every complete frame.
+// Returns false if the server closed the connection or sent a malformed frame.
+template<typename OnResponse>
+static bool read_responses(int fd, std::string& in, OnResponse&& on_response) {
+	char buffer[16384];
+	auto n = read(fd, buffer, sizeof(buffer));
+	if (n <= 0) return n < 0 && errno == EINTR;
+	in.append(buffer, n);
+
+	size_t offset = 0;
+	while (in.size() - offset >= response_header_size) {
+		auto length = get_u32(in.data() + offset);
+		if (length > max_frame_length) return false;
+		if (in.size() - offset < response_header_size + length) break;
+
+		auto id = get_u32(in.data() + offset + 4);
+		auto status = static_cast<ResponseStatus>(in[offset + 8]);
+		on_response(id, status, std::string_view(in.data() + offset + response_header_size, length));
+		offset += response_header_size + length;
+	}
+	in.erase(0, offset);
+	return true;
+}
+
+static int evaluate_expressions(const std::string& socket_path, const std::vector<std::string>& expressions) {
+	int fd = connect_to(socket_path);
+	if (fd < 0) {
+		std::cout << "Unable to connect to " << socket_path << ": " << std::strerror(errno) << "\n";
+		return -1;
+	}
+
+	std::string out;
+	for (size_t i = 0; i < expressions.size(); i++) {
+		put_request(out, static_cast<uint32_t>(i), expressions[i]);
+	}
+	send_all(fd, out);
+
+	std::vector<std::string> results(expressions.size());
+	size_t received = 0;
+	std::string in;
+	while (received < expressions.size()) {
+		bool ok = read_responses(fd, in, [&](uint32_t id, ResponseStatus status, std::string_view text) {
+			if (id >= results.size()) return;
+			results[id] = status == EVAL_OK ? std::string(text) : "error: " + std::string(text);
+			++received;
+		});
+		if (!ok) break;
+	}
+	close(fd);
+
+	for (size_t i = 0; i < expressions.size(); i++) {
+		// scanner diagnostics already end in a newline
+		auto& result = results[i];
+		if (!result.empty() && result.back() == '\n') result.pop_back();
+		std::cout << expressions[i] << " = " << (result.empty() ? "(no response)" : result) << "\n";
+	}
+	return received == expressions.size() ? 0 : -1;
+}
+
+static void run_connection(const std::string& socket_path, const std::vector<Sample>& samples,
+	size_t requests, size_t depth, size_t offset, Result& result)
+{
+	int fd = connect_to(socket_path);
+	if (fd < 0) {
+		result.failed = true;
+		return;
+	}
+
+	std::vector<Clock::time_point> sent_at(requests);
+	result.latencies_us.reserve(requests);
+
+	size_t sent = 0;
+	size_t received = 0;
+	std::string out;
+	std::string in;
+
+	auto send_more = [&](size_t count) {
+		out.clear();
+		for (; count > 0 && sent < requests; count--, sent++) {
+			auto& sample = samples[(offset + sent) % samples.size()];
+			put_request(out, static_cast<uint32_t>(sent), sample.expression);
+			sent_at[sent] = Clock::now();
+		}
+		return out.empty() || send_all(fd, out);
+	};
+
+	if (!send_more(depth)) result.failed = true;
+
+	while (!result.failed && received < requests) {
+		size_t completed = 0;
+		bool ok = read_responses(fd, in, [&](uint32_t id, ResponseStatus status, std::string_view text) {
+			if (id >= requests) return;
+			auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - sent_at[id]);
+			result.latencies_us.push_back(elapsed.count());
+
+			auto& expected = samples[(offset + id) % samples.size()].expected;
+			if (status != EVAL_OK) ++result.errors;
+			else if (!expected.empty() && text != expected) ++result.mismatches;
+			++completed;
+		});
+		if (!ok) {
+			result.failed = true;
+			break;
+		}
+		received += completed;
+		if (!send_more(completed)) result.failed = true;
+	}
+	close(fd);
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) return 0;
+	auto index = static_cast<size_t>(p / 100 * (sorted.size() - 1));
+	return sorted[index];
+}
+
+static inline void print_usage() {
+	std::cout << "usage: ./expressions-client <path/to/socket> -e <expression> [-e <expression> ...]\n"
+		"       ./expressions-client <path/to/socket> [-c <connections>] [-n <requests-per-connection>]\n"
+		"                            [-p <pipeline-depth>] [-f <path/to/expressions/file>]\n";
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || argv[1][0] == '-') {
+		print_usage();
+		return 1;
+	}
+
+	std::string socket_path = argv[1];
+	std::vector<std::string> expressions;
+	std::vector<Sample> samples;
+	size_t connections = 4;
+	size_t requests = 100000;
+	size_t depth = 64;
+
+	for (int i = 2; i < argc; i++) {
+		std::string option = argv[i];
+		if (i + 1 >= argc) {
+			print_usage();
+			return 1;
+		}
+
+		if (option == "-e") {
+			expressions.push_back(argv[++i]);
+		}
+		else if (option == "-f") {
+			std::ifstream file(argv[++i], std::ios::in);
+			if (!file.is_open()) {
+				std::cout << "Unable to open " << argv[i] << " file.\n";
+				return -1;
+			}
+			std::string line;
+			while (std::getline(file, line)) {
+				if (line != "") samples.push_back({ line, "" });
+			}
+		}
+		else if (option == "-c" || option == "-n" || option == "-p") {
+			auto value = std::strtoul(argv[++i], nullptr, 10);
+			if (value == 0) {
+				print_usage();
+				return 1;
+			}
+			(option == "-c" ? connections : option == "-n" ? requests : depth) = value;
+		}
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	if (!expressions.empty()) return evaluate_expressions(socket_path, expressions);
+	if (samples.empty()) samples = builtin_samples;
+
+	std::vector<Result> results(connections);
+	std::vector<std::thread> threads;
+	auto start = Clock::now();
+	for (size_t i = 0; i < connections; i++) {
+		threads.emplace_back(run_connection, std::cref(socket_path), std::cref(samples),
+			requests, depth, i, std::ref(results[i]));
+	}
+	for (auto& thread : threads) thread.join();
+	auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::vector<double> latencies;
+	size_t errors = 0, mismatches = 0, failed = 0;
+	for (auto& result : results) {
+		latencies.insert(latencies.end(), result.latencies_us.begin(), result.latencies_us.end());
+		errors += result.errors;
+		mismatches += result.mismatches;
+		failed += result.failed;
+	}
+	std::sort(latencies.begin(), latencies.end());
+
+	std::cout << "connections: " << connections << ", pipeline depth: " << depth << "\n"
+		<< "responses:   " << latencies.size() << " in " << elapsed << " s ("
+		<< static_cast<size_t>(latencies.size() / elapsed) << " req/s)\n"
+		<< "latency us:  p50 " << percentile(latencies, 50) << ", p90 " << percentile(latencies, 90)
+		<< ", p99 " << percentile(latencies, 99) << ", p99.9 " << percentile(latencies, 99.9)
+		<< ", max " << (latencies.empty() ? 0 : latencies.back()) << "\n"
+		<< "errors: " << errors << ", wrong results: " << mismatches << ", failed connections: " << failed << "\n";
+
+	return (failed || mismatches) ? -1 : 0;
+}
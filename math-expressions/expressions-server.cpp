@@ -0,0 +1,464 @@
+#include <atomic>
+#include <condition_variable>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "evaluator.h"
+#include "server-protocol.h"
+
+// Long-running evaluation server for the 'mathematical expressions' grammar.
+//
+// A single epoll thread owns every socket. Complete request frames read from a
+// connection are grouped into batches and handed to a pool of worker threads, which
+// share the (read-only) parse tables. Workers encode their responses and post them
+// back to the event loop through an eventfd; the event loop appends them to the
+// connection's output buffer and writes them out as the socket allows.
+
+struct Request {
+	uint32_t id;
+	std::string expression;
+};
+
+struct Batch {
+	uint64_t connection;
+	std::vector<Request> requests;
+};
+
+struct Completed {
+	uint64_t connection;
+	size_t count;
+	std::string frames;
+};
+
+struct Connection {
+	int fd;
+	std::string in;
+	std::string out;
+	size_t in_flight = 0;
+	bool read_closed = false;
+	bool want_write = false;
+};
+
+// epoll_event.data.u64 tags. Connection ids start after these.
+constexpr uint64_t listener_tag = 0;
+constexpr uint64_t completion_tag = 1;
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void on_signal(int) {
+	stop_requested = 1;
+}
+
+class BatchQueue {
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::deque<Batch> batches;
+	bool closed = false;
+
+public:
+	void push(Batch batch) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			batches.push_back(std::move(batch));
+		}
+		ready.notify_one();
+	}
+
+	// Blocks until a batch is available. Returns false once the queue is closed and drained.
+	bool pop(Batch& batch) {
+		std::unique_lock<std::mutex> lock(mutex);
+		ready.wait(lock, [this] { return closed || !batches.empty(); });
+		if (batches.empty()) return false;
+		batch = std::move(batches.front());
+		batches.pop_front();
+		return true;
+	}
+
+	void close() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+		}
+		ready.notify_all();
+	}
+};
+
+class CompletionQueue {
+	std::mutex mutex;
+	std::vector<Completed> completed;
+	int event_fd;
+
+public:
+	explicit CompletionQueue(int efd) : event_fd{ efd } {}
+
+	void push(Completed done) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			completed.push_back(std::move(done));
+		}
+		uint64_t one = 1;
+		// eventfd counters only fail on overflow, which cannot happen with a reader attached.
+		(void)!write(event_fd, &one, sizeof(one));
+	}
+
+	void drain(std::vector<Completed>& out) {
+		uint64_t count;
+		(void)!read(event_fd, &count, sizeof(count));
+		std::lock_guard<std::mutex> lock(mutex);
+		out.swap(completed);
+	}
+};
+
+static void evaluate(const Request& request, std::vector<Token>& tokens, std::string& scan_errors, std::string& frames) {
+	tokens.clear();
+	scan_errors.clear();
+
+	if (!scan(request.expression, tokens, scan_errors)) {
+		put_response(frames, request.id, EVAL_SCAN_ERROR, scan_errors);
+		return;
+	}
+
+	float output = 0;
+	bool valid = false;
+	try {
+		valid = parse(tokens, output);
+	}
+	catch (std::exception const& ex) {
+		// std::stoi rejects numeric literals beyond the integer range
+		put_response(frames, request.id, EVAL_PARSE_ERROR, "Invalid numeric literal");
+		return;
+	}
+
+	if (!valid) {
+		put_response(frames, request.id, EVAL_PARSE_ERROR, "Invalid Input String");
+		return;
+	}
+
+	// Same formatting as the REPL's 'std::cout << output'
+	char result[32];
+	auto length = std::snprintf(result, sizeof(result), "%g", output);
+	put_response(frames, request.id, EVAL_OK, std::string_view(result, length));
+}
+
+static void worker(BatchQueue& batches, CompletionQueue& completions) {
+	std::vector<Token> tokens;
+	std::string scan_errors;
+	Batch batch;
+
+	while (batches.pop(batch)) {
+		Completed done{ batch.connection, batch.requests.size(), {} };
+		for (auto& request : batch.requests) {
+			evaluate(request, tokens, scan_errors, done.frames);
+		}
+		completions.push(std::move(done));
+	}
+}
+
+class Server {
+	int epoll_fd = -1;
+	int listen_fd = -1;
+	int event_fd = -1;
+	std::string socket_path;
+	size_t batch_size;
+
+	uint64_t next_connection = completion_tag + 1;
+	std::unordered_map<uint64_t, Connection> connections;
+
+	BatchQueue batches;
+	CompletionQueue* completions = nullptr;
+
+	void update_events(uint64_t id, Connection& connection) {
+		epoll_event event{};
+		// once the client has shut down its side, only wait for the socket to drain
+		event.events = (connection.read_closed ? static_cast<uint32_t>(0) : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP))
+			| (connection.want_write ? static_cast<uint32_t>(EPOLLOUT) : static_cast<uint32_t>(0));
+		event.data.u64 = id;
+		epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+	}
+
+	void close_connection(uint64_t id) {
+		auto found = connections.find(id);
+		if (found == connections.end()) return;
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, found->second.fd, nullptr);
+		close(found->second.fd);
+		connections.erase(found);
+	}
+
+	void accept_connections() {
+		while (true) {
+			int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (fd < 0) return;
+
+			auto id = next_connection++;
+			connections[id].fd = fd;
+
+			epoll_event event{};
+			event.events = EPOLLIN | EPOLLRDHUP;
+			event.data.u64 = id;
+			epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+		}
+	}
+
+	// Write as much of the output buffer as the socket accepts. Returns false if the
+	// connection was closed.
+	bool flush(uint64_t id, Connection& connection) {
+		size_t written = 0;
+		while (written < connection.out.size()) {
+			auto n = send(connection.fd, connection.out.data() + written, connection.out.size() - written, MSG_NOSIGNAL);
+			if (n < 0) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+				if (errno == EINTR) continue;
+				close_connection(id);
+				return false;
+			}
+			written += n;
+		}
+		connection.out.erase(0, written);
+
+		if (connection.read_closed && connection.in_flight == 0 && connection.out.empty()) {
+			close_connection(id);
+			return false;
+		}
+
+		bool want_write = !connection.out.empty();
+		if (want_write != connection.want_write) {
+			connection.want_write = want_write;
+			update_events(id, connection);
+		}
+		return true;
+	}
+
+	void read_requests(uint64_t id, Connection& connection) {
+		char buffer[16384];
+		while (true) {
+			auto n = read(connection.fd, buffer, sizeof(buffer));
+			if (n > 0) {
+				connection.in.append(buffer, n);
+				continue;
+			}
+			if (n == 0) connection.read_closed = true;
+			else if (errno == EINTR) continue;
+			else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				close_connection(id);
+				return;
+			}
+			break;
+		}
+
+		if (connection.read_closed) update_events(id, connection);
+
+		// split the buffered bytes into complete frames, batch_size requests per batch
+		size_t offset = 0;
+		Batch batch{ id, {} };
+		while (connection.in.size() - offset >= request_header_size) {
+			auto length = get_u32(connection.in.data() + offset);
+			if (length > max_frame_length) {
+				std::cout << "Closing connection: request frame of " << length << " bytes exceeds limit\n";
+				close_connection(id);
+				return;
+			}
+			if (connection.in.size() - offset < request_header_size + length) break;
+
+			auto request_id = get_u32(connection.in.data() + offset + 4);
+			batch.requests.push_back({ request_id, connection.in.substr(offset + request_header_size, length) });
+			offset += request_header_size + length;
+
+			if (batch.requests.size() == batch_size) {
+				connection.in_flight += batch.requests.size();
+				batches.push(std::move(batch));
+				batch = Batch{ id, {} };
+			}
+		}
+		connection.in.erase(0, offset);
+
+		if (!batch.requests.empty()) {
+			connection.in_flight += batch.requests.size();
+			batches.push(std::move(batch));
+		}
+
+		if (connection.read_closed && connection.in_flight == 0 && connection.out.empty()) {
+			close_connection(id);
+		}
+	}
+
+	void deliver_completions(std::vector<Completed>& completed) {
+		completions->drain(completed);
+		for (auto& done : completed) {
+			auto found = connections.find(done.connection);
+			// the client hung up before its results were ready
+			if (found == connections.end()) continue;
+
+			auto& connection = found->second;
+			connection.in_flight -= done.count;
+			connection.out += done.frames;
+			flush(done.connection, connection);
+		}
+		completed.clear();
+	}
+
+public:
+	Server(std::string path, size_t batch) : socket_path{ std::move(path) }, batch_size{ batch } {}
+
+	~Server() {
+		for (auto& connection : connections) close(connection.second.fd);
+		if (listen_fd >= 0) {
+			close(listen_fd);
+			unlink(socket_path.c_str());
+		}
+		if (event_fd >= 0) close(event_fd);
+		if (epoll_fd >= 0) close(epoll_fd);
+	}
+
+	bool open() {
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (socket_path.size() >= sizeof(address.sun_path)) {
+			std::cout << "Socket path is too long: " << socket_path << "\n";
+			return false;
+		}
+		std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+		listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (listen_fd < 0) {
+			std::cout << "socket(): " << std::strerror(errno) << "\n";
+			return false;
+		}
+
+		unlink(socket_path.c_str());
+		if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+			listen(listen_fd, SOMAXCONN) < 0)
+		{
+			std::cout << "Unable to listen on " << socket_path << ": " << std::strerror(errno) << "\n";
+			return false;
+		}
+
+		epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (epoll_fd < 0 || event_fd < 0) {
+			std::cout << "Unable to create event loop: " << std::strerror(errno) << "\n";
+			return false;
+		}
+
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.u64 = listener_tag;
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+		event.data.u64 = completion_tag;
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &event);
+		return true;
+	}
+
+	void run(size_t worker_count) {
+		CompletionQueue completion_queue(event_fd);
+		completions = &completion_queue;
+
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < worker_count; i++) {
+			workers.emplace_back(worker, std::ref(batches), std::ref(completion_queue));
+		}
+
+		std::vector<Completed> completed;
+		epoll_event events[256];
+		while (!stop_requested) {
+			int ready = epoll_wait(epoll_fd, events, 256, -1);
+			if (ready < 0) {
+				if (errno == EINTR) continue;
+				std::cout << "epoll_wait(): " << std::strerror(errno) << "\n";
+				break;
+			}
+
+			for (int i = 0; i < ready; i++) {
+				auto tag = events[i].data.u64;
+				if (tag == listener_tag) {
+					accept_connections();
+					continue;
+				}
+				if (tag == completion_tag) {
+					deliver_completions(completed);
+					continue;
+				}
+
+				auto found = connections.find(tag);
+				if (found == connections.end()) continue;
+				auto& connection = found->second;
+
+				// EPOLLHUP means both directions are shut, so results could not be delivered anyway
+				if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+					close_connection(tag);
+					continue;
+				}
+				if (events[i].events & EPOLLOUT) {
+					if (!flush(tag, connection)) continue;
+				}
+				if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+					read_requests(tag, connection);
+				}
+			}
+		}
+
+		batches.close();
+		for (auto& thread : workers) thread.join();
+		completions = nullptr;
+	}
+};
+
+static inline void print_usage() {
+	std::cout << "usage: ./expressions-server <path/to/socket> [-w <worker-threads>] [-b <batch-size>]\n";
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || argv[1][0] == '-') {
+		print_usage();
+		return 1;
+	}
+
+	size_t worker_count = std::thread::hardware_concurrency();
+	if (worker_count == 0) worker_count = 1;
+	size_t batch_size = 64;
+
+	for (int i = 2; i < argc; i++) {
+		std::string option = argv[i];
+		if ((option == "-w" || option == "-b") && i + 1 < argc) {
+			auto value = std::strtoul(argv[++i], nullptr, 10);
+			if (value == 0) {
+				print_usage();
+				return 1;
+			}
+			(option == "-w" ? worker_count : batch_size) = value;
+		}
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	struct sigaction action{};
+	action.sa_handler = on_signal;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+
+	Server server(argv[1], batch_size);
+	if (!server.open()) return -1;
+
+	std::cout << "Math Expressions Server listening on " << argv[1] << " (" << worker_count
+		<< " worker threads, CTRL-C to exit)\n" << std::flush;
+	server.run(worker_count);
+	std::cout << "\nquit...\n";
+	PARSEGEN_PROFILE_EXPORT(reduce_info);
+}
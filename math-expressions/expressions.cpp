@@ -1,190 +1,38 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <stack>
+#include <string_view>
 
-#include "parse-tables.h"
+#include "evaluator.h"
+#include "constant-evaluator.h"
+#include "grammar-sources.h"
 
-static bool is_whitespace(char c) {
-	return (c == ' ' || c == '\r' || c == '\t');
-}
-
-static bool is_digit(char c) {
-	return c >= '0' && c <= '9';
-}
-
-struct Token {
-	TokenType type;
-	std::string value;
-};
-
-static bool scan(std::string& input, std::vector<Token>& output) {
-	bool scan_error = false;
-	auto start = 0;
-	
-	for (auto i = 0; i < input.size(); i++) {
-		if (input[i] == '\n' ||
-			is_whitespace(input[i]))
-		{
-			start = i + 1;
-			continue;
-		}
-
-		switch (input[i]) {
-		case '(': {
-			Token token{ TokenType::t_LP, std::string(input, start, 1)};
-			output.push_back(token);
-			start = i + 1;
-			break;
-		}
-		case ')': {
-			Token token{ TokenType::t_RP, std::string(input, start, 1) };
-			output.push_back(token);
-			start = i + 1;
-			break;
-		}
-		case '+': {
-			Token token{ TokenType::t_PLUS, std::string(input, start, 1) };
-			output.push_back(token);
-			start = i + 1;
-			break;
-		}
-		case '-': {
-			Token token{ TokenType::t_MINUS, std::string(input, start, 1) };
-			output.push_back(token);
-			start = i + 1;
-			break;
-		}
-		case '*': {
-			Token token{ TokenType::t_TIMES, std::string(input, start, 1) };
-			output.push_back(token);
-			start = i + 1;
-			break;
-		}
-		case '/': {
-			Token token{ TokenType::t_DIVIDE, std::string(input, start, 1) };
-			output.push_back(token);
-			start = i + 1;
-			break;
-		}
-		default:
-			if (is_digit(input[i])) {
-				while (is_digit(input[i])) {
-					++i;
-				}
-				Token token{ TokenType::t_NUMBER, std::string(input, start, i - start) };
-				i--;
-				output.push_back(token);
-			}
-			else {
-				std::cout << "Unexpected token '" << input[i] << "'\n";
-				scan_error = true;
-			}
-			start = i + 1;
-		}
-	}
-	if (scan_error) {
-		return false;
-	}
-	Token token{ TokenType::t_EOF, "$" };
-	output.push_back(token);
-	return true;
-}
-
-static bool parse(std::vector<Token> tokens, float& output) {
-	std::stack<size_t> states;
-	std::stack<float> values;
-	
-	states.push(0);
-	auto state = static_cast<size_t>(0);
-	
-	for (auto i = 0; i < tokens.size();) {
-		state = states.top();
-		if (actionTable.find(std::make_pair(state, tokens[i].type)) == actionTable.end()) {
-			return false;
-		}
-	
-		Action& action = actionTable[std::make_pair(state, tokens[i].type)];
-	
-		if (action.type == ActionType::REDUCE) {
-			auto index = actionTable[std::make_pair(state, tokens[i].type)].value;
-			auto pop_count = reduce_info[index].second;
-			while (pop_count--) {
-				states.pop();
-			}
-			state = states.top();
-			auto reduce_symbol = reduce_info[index].first;
-			auto next_state = gotoTable[std::make_pair(state, reduce_symbol)];
-			states.push(next_state);
-
-			if (reduce_symbol == "Add") {
-				auto rhs = values.top();
-				values.pop();
-				auto lhs = values.top();
-				values.pop();
-				values.push(lhs + rhs);
-			}
-			else if (reduce_symbol == "Sub") {
-				auto rhs = values.top();
-				values.pop();
-				auto lhs = values.top();
-				values.pop();
-				values.push(lhs - rhs);
-			}
-			else if (reduce_symbol == "Mul") {
-				auto rhs = values.top();
-				values.pop();
-				auto lhs = values.top();
-				values.pop();
-				values.push(lhs * rhs);
-			}
-			else if (reduce_symbol == "Div") {
-				auto rhs = values.top();
-				values.pop();
-				auto lhs = values.top();
-				values.pop();
-				values.push(lhs / rhs);
-			}
-			else if (reduce_symbol == "Unary") {
-				auto val = values.top();
-				values.pop();
-				values.push(-val);
-			}
-		}
-		else if (action.type == ActionType::SHIFT) {
-			auto next_state = actionTable[std::make_pair(state, tokens[i].type)].value;
-			states.push(next_state);
-			// Only SHIFT actions proceed to the next symbol
-			if (tokens[i].type == t_NUMBER) {
-				values.push(std::stoi(tokens[i].value));
-			}
-			++i;
-		}
-		else if (action.type == ActionType::ACCEPT) {
-			output = values.top();
-			return true;
-		}
-	}
-
-	return false;
-}
+// The grammar built into constant-evaluator.h is expr-grammar.txt, and its README examples compile
+static_assert(std::string_view(expression_grammar) == expr_grammar_source,
+	"the grammar of constant-evaluator.h differs from expr-grammar.txt");
+static_assert(constant_expression("2*(3+4)").valid && constant_expression("2*(3+4)").value == 14, "2*(3+4)");
+static_assert(!constant_expression("2*(3+").valid, "2*(3+");
 
 int main() {
 	std::string input;
 	std::vector<Token> tokens;
+	std::string scan_errors;
 	float output = 0;
 	std::cout << "Math Expressions Evaluator ('q' or CTRL-C to exit)\n";
 	while (true) {
 		std::cout << "> ";
 		if (!std::getline(std::cin, input) || input == "q") {
 			std::cout << (input == "q" ? "quit...\n" : "\nquit...\n");
+			PARSEGEN_PROFILE_EXPORT(reduce_info);
 			return 0;
 		}
 		else if (input == "") {
 			continue;
 		}
 
-		if (!scan(input, tokens)) {
+		if (!scan(input, tokens, scan_errors)) {
+			std::cout << scan_errors;
+			scan_errors.clear();
 			tokens.clear();
 			continue;
 		}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Wire format of the expression evaluation server. All integers are little-endian.
+//
+// request:  [u32 length][u32 id][length bytes: expression text]
+// response: [u32 length][u32 id][u8 status][length bytes: result text]
+//
+// 'id' is chosen by the client and echoed back unchanged. Requests may be pipelined;
+// responses are returned as soon as they are evaluated, so they may arrive out of order.
+
+enum ResponseStatus : uint8_t {
+	EVAL_OK,          // result text is the evaluated value
+	EVAL_SCAN_ERROR,  // result text holds the scanner diagnostics
+	EVAL_PARSE_ERROR, // input is not a valid expression
+};
+
+constexpr size_t request_header_size = 8;
+constexpr size_t response_header_size = 9;
+
+// Frames larger than this are treated as a protocol error and the connection is closed.
+constexpr uint32_t max_frame_length = 1 << 20;
+
+static inline void put_u32(std::string& out, uint32_t value) {
+	out += static_cast<char>(value & 0xff);
+	out += static_cast<char>((value >> 8) & 0xff);
+	out += static_cast<char>((value >> 16) & 0xff);
+	out += static_cast<char>((value >> 24) & 0xff);
+}
+
+static inline uint32_t get_u32(const char* in) {
+	auto bytes = reinterpret_cast<const unsigned char*>(in);
+	return static_cast<uint32_t>(bytes[0]) |
+		(static_cast<uint32_t>(bytes[1]) << 8) |
+		(static_cast<uint32_t>(bytes[2]) << 16) |
+		(static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+static inline void put_request(std::string& out, uint32_t id, std::string_view expression) {
+	put_u32(out, static_cast<uint32_t>(expression.size()));
+	put_u32(out, id);
+	out += expression;
+}
+
+static inline void put_response(std::string& out, uint32_t id, ResponseStatus status, std::string_view result) {
+	put_u32(out, static_cast<uint32_t>(result.size()));
+	put_u32(out, id);
+	out += static_cast<char>(status);
+	out += result;
+}
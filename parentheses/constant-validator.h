@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "../runtime/constexpr-tables.h"
+
+// Recognition of constant bracket patterns by the compiler. The 'parentheses' grammar is built into
+// tables at compile time (runtime/constexpr-tables.h), and constant_parentheses() scans and parses a
+// string literal with them, with the semantics of scan() and parse() of validator.h:
+//
+//   static_assert(constant_parentheses("(())()").valid, "malformed pattern");
+//
+// Like any constexpr function, it can be called at runtime too.
+
+// paren-grammar.txt
+static constexpr char parentheses_grammar[] =
+	"t_EOF\n"
+	"t_LP\n"
+	"t_RP\n"
+	"\n"
+	"Goal > List\n"
+	"List > List Pair\n"
+	"List > Pair\n"
+	"Pair > t_LP Pair t_RP\n"
+	"Pair > t_LP t_RP\n";
+
+struct ConstantParentheses {
+	bool valid = false;
+	size_t error_offset = 0; // where scanning or parsing stopped, when not valid
+};
+
+template<size_t N>
+constexpr ConstantParentheses constant_parentheses(const char (&input)[N]) {
+	constexpr auto& tables = constexpr_tables::tables<parentheses_grammar>;
+	constexpr uint32_t left = tables.terminal("t_LP"), right = tables.terminal("t_RP"), end = tables.terminal("t_EOF");
+
+	std::array<uint32_t, N + 1> tokens{};
+	std::array<size_t, N + 1> offsets{};
+	size_t count = 0;
+	std::string_view text(input, N - 1);
+	for (size_t i = 0; i < text.size(); i++) {
+		auto c = text[i];
+		if (c == ' ' || c == '\r' || c == '\t' || c == '\n') continue;
+		if (c != '(' && c != ')') return { false, i };
+		offsets[count] = i;
+		tokens[count++] = c == '(' ? left : right;
+	}
+	offsets[count] = text.size();
+	tokens[count++] = end;
+
+	std::array<uint32_t, N + 2> states{};
+	size_t position = 0;
+	auto on_shift = [&](size_t shifted) { position = shifted + 1; };
+	if (!tables.parse(tokens.data(), count, states, on_shift, [](uint32_t) {})) return { false, offsets[position] };
+	return { true, 0 };
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
@@ -7,55 +8,56 @@
 #include <vector>
 
 std::unordered_set<std::string> strings {
-	"Goal", "Pair", "List"
+	"Goal", "List", "Pair"
 };
 
 enum TokenType {
-	t_RP, t_EOF, t_LP
+	t_EOF, t_LP, t_RP
 };
 
 std::vector<std::pair<std::string_view, size_t>> reduce_info {
-	{ *strings.find("Goal"), 1 }, { *strings.find("Pair"), 3 },
-	{ *strings.find("List"), 2 }, { *strings.find("List"), 1 },
-	{ *strings.find("Pair"), 2 }
+	{ *strings.find("Goal"), 1 }, { *strings.find("List"), 1 },
+	{ *strings.find("List"), 2 }, { *strings.find("Pair"), 2 },
+	{ *strings.find("Pair"), 3 }
 };
 
 struct PairHash {
-	size_t operator()(const std::pair<size_t, std::string_view>& pair) const {
+	size_t operator()(const std::pair<uint8_t, std::string_view>& pair) const {
 		return std::hash<size_t>{}(pair.first) ^ std::hash<std::string_view>{}(pair.second);
 	}
 
-	size_t operator()(const std::pair<size_t, TokenType>& pair) const {
+	size_t operator()(const std::pair<uint8_t, TokenType>& pair) const {
 		return std::hash<size_t>{}(pair.first) ^ pair.second;
 	}
 };
 
-enum ActionType {
+enum ActionType : uint8_t {
 	SHIFT,
 	REDUCE,
 	ACCEPT
 };
 
+// One uint8_t: the ActionType, and the next state or index into reduce_info
 struct Action {
-	ActionType type;
-	size_t value;
+	ActionType type : 2;
+	uint8_t value : 6;
 };
 
-std::unordered_map<std::pair<size_t, TokenType>, Action, PairHash> actionTable {
-	{{ 6, t_EOF }, {REDUCE, 4 }}, {{ 0, t_LP }, {SHIFT, 2 }},
-	{{ 8, t_RP }, {SHIFT, 10 }}, {{ 6, t_LP }, {REDUCE, 4 }},
-	{{ 11, t_LP }, {REDUCE, 1 }}, {{ 5, t_RP }, {SHIFT, 11 }},
-	{{ 11, t_EOF }, {REDUCE, 1 }}, {{ 4, t_EOF }, {REDUCE, 2 }},
-	{{ 10, t_RP }, {REDUCE, 1 }}, {{ 4, t_LP }, {REDUCE, 2 }},
-	{{ 7, t_LP }, {SHIFT, 7 }}, {{ 9, t_RP }, {REDUCE, 4 }},
-	{{ 3, t_EOF }, {REDUCE, 3 }}, {{ 3, t_LP }, {REDUCE, 3 }},
-	{{ 1, t_EOF }, {ACCEPT, 0 }}, {{ 1, t_LP }, {SHIFT, 2 }},
-	{{ 2, t_RP }, {SHIFT, 6 }}, {{ 2, t_LP }, {SHIFT, 7 }},
-	{{ 7, t_RP }, {SHIFT, 9 }}
+std::unordered_map<std::pair<uint8_t, TokenType>, Action, PairHash> actionTable {
+	{{ 0, t_LP }, {SHIFT, 1 }}, {{ 1, t_LP }, {SHIFT, 4 }},
+	{{ 1, t_RP }, {SHIFT, 5 }}, {{ 2, t_EOF }, {ACCEPT, 0 }},
+	{{ 2, t_LP }, {SHIFT, 1 }}, {{ 3, t_EOF }, {REDUCE, 1 }},
+	{{ 3, t_LP }, {REDUCE, 1 }}, {{ 4, t_LP }, {SHIFT, 4 }},
+	{{ 4, t_RP }, {SHIFT, 8 }}, {{ 5, t_EOF }, {REDUCE, 3 }},
+	{{ 5, t_LP }, {REDUCE, 3 }}, {{ 6, t_RP }, {SHIFT, 10 }},
+	{{ 7, t_EOF }, {REDUCE, 2 }}, {{ 7, t_LP }, {REDUCE, 2 }},
+	{{ 8, t_RP }, {REDUCE, 3 }}, {{ 9, t_RP }, {SHIFT, 11 }},
+	{{ 10, t_EOF }, {REDUCE, 4 }}, {{ 10, t_LP }, {REDUCE, 4 }},
+	{{ 11, t_RP }, {REDUCE, 4 }}
 };
 
-std::unordered_map<std::pair<size_t, std::string_view>, size_t, PairHash> gotoTable {
-	{{ 0, *strings.find("List") }, {1}}, {{ 0, *strings.find("Pair") }, {3}},
-	{{ 1, *strings.find("Pair") }, {4}}, {{ 2, *strings.find("Pair") }, {5}},
-	{{ 7, *strings.find("Pair") }, {8}}
+std::unordered_map<std::pair<uint8_t, std::string_view>, uint8_t, PairHash> gotoTable {
+	{{ 0, *strings.find("List") }, {2}}, {{ 0, *strings.find("Pair") }, {3}},
+	{{ 1, *strings.find("Pair") }, {6}}, {{ 2, *strings.find("Pair") }, {7}},
+	{{ 4, *strings.find("Pair") }, {9}}
 };
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stack>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parse-tables.h"
+#include "../runtime/parse-profile.h"
+
+// Scanner and table-driven recognizer for the 'parentheses' grammar, shared by the
+// REPL interpreter and the runtime benchmark.
+
+static bool is_whitespace(char c) {
+	return (c == ' ' || c == '\r' || c == '\t');
+}
+
+// Scan 'input' into 'output', terminated by a t_EOF token. Diagnostics for unexpected
+// characters are appended to 'errors'.
+static bool scan(std::string_view input, std::vector<TokenType>& output, std::string& errors) {
+	bool scan_error = false;
+	for (auto c : input) {
+		if (c == '\n' ||
+			is_whitespace(c)) {
+			continue;
+		}
+
+		switch (c) {
+		case '(':
+			output.push_back(TokenType::t_LP);
+			break;
+		case ')':
+			output.push_back(TokenType::t_RP);
+			break;
+		default:
+			errors += "Unexpected token '";
+			errors += c;
+			errors += "'\n";
+			scan_error = true;
+		}
+	}
+	if (scan_error) {
+		return false;
+	}
+	output.push_back(TokenType::t_EOF);
+	return true;
+}
+
+static bool parse(std::vector<TokenType> tokens) {
+	std::stack<size_t> states;
+	states.push(0);
+	auto state = static_cast<size_t>(0);
+
+	for (size_t i = 0; i < tokens.size();) {
+		state = states.top();
+		PARSEGEN_PROFILE_LOOKUP(state);
+		if (actionTable.find(std::make_pair(state, tokens[i])) == actionTable.end()) {
+			PARSEGEN_PROFILE_MISS(state);
+			return false;
+		}
+		
+		Action& action = actionTable[std::make_pair(state, tokens[i])];
+
+		if (action.type == ActionType::REDUCE) {
+			auto index = actionTable[std::make_pair(state, tokens[i])].value;
+			PARSEGEN_PROFILE_REDUCE(index);
+			auto pop_count = reduce_info[index].second;
+			while (pop_count--) {
+				states.pop();
+			}
+			state = states.top();
+			auto reduce_symbol = reduce_info[index].first;
+			auto next_state = gotoTable[std::make_pair(state, reduce_symbol)];
+			states.push(next_state);
+			PARSEGEN_PROFILE_DEPTH(states.size());
+		}
+		else if (action.type == ActionType::SHIFT) {
+			PARSEGEN_PROFILE_SHIFT(state, tokens[i]);
+			auto next_state = actionTable[std::make_pair(state, tokens[i])].value;
+			states.push(next_state);
+			PARSEGEN_PROFILE_DEPTH(states.size());
+			// Only SHIFT actions proceed to the next symbol
+			++i;
+		}
+		else if (action.type == ActionType::ACCEPT) {
+			return true;
+		}
+	}
+	return false;
+}
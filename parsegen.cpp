@@ -1,14 +1,43 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <list>
 #include <map>
+#include <memory_resource>
+#include <random>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
 
+#include "runtime/binary-tables.h"
+#include "runtime/lazy-tables.h"
+#include "runtime/parse-profile.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PARSEGEN_GRAMMAR_MMAP
+#endif
+
+// Version of what parsegen writes, part of the generation cache key: bump it with any change to the
+// output of a given grammar and options. Builds through CMake also define PARSEGEN_SOURCE_HASH, a hash
+// of the generator sources, so that cached outputs of a modified generator are never reused.
+#define PARSEGEN_OUTPUT_VERSION "1"
+#ifndef PARSEGEN_SOURCE_HASH
+#define PARSEGEN_SOURCE_HASH ""
+#endif
+
 static bool is_alpha(char c) {
 	return (c >= 'a' && c <= 'z') ||
 		(c >= 'A' && c <= 'Z');
@@ -18,6 +47,80 @@ static bool is_whitespace(char c) {
 	return (c == ' ' || c == '\r' || c == '\t');
 }
 
+enum class IntegerField { VALID, INVALID, OUT_OF_RANGE };
+
+// Read 'field' the way std::stoi does: an optionally signed integer, ignoring anything after it
+static IntegerField parse_integer(std::string_view field, int& value) {
+	auto begin = field.data();
+	auto end = begin + field.size();
+	if (end - begin > 1 && begin[0] == '+' && begin[1] != '-') ++begin;
+
+	auto result = std::from_chars(begin, end, value);
+	if (result.ec == std::errc::invalid_argument) return IntegerField::INVALID;
+	if (result.ec == std::errc::result_out_of_range) return IntegerField::OUT_OF_RANGE;
+	return IntegerField::VALID;
+}
+
+// --stats: wall time and peak resident memory of every generator phase
+struct PhaseStats {
+	std::string name;
+	double seconds;
+	long peak_memory_kb; // -1 where the platform offers no measurement
+};
+
+class PhaseRecorder {
+	using Clock = std::chrono::steady_clock;
+
+	bool enabled;
+	std::string current;
+	Clock::time_point started;
+
+	// The kernel's peak RSS counter is reset at the start of every phase, so each phase
+	// reports its own peak rather than that of the whole run.
+	static bool reset_peak_memory() {
+#ifdef __linux__
+		std::ofstream clear_refs("/proc/self/clear_refs", std::ios::out);
+		clear_refs << "5";
+		return static_cast<bool>(clear_refs.flush());
+#else
+		return false;
+#endif
+	}
+
+	static long peak_memory_kb() {
+#ifdef __linux__
+		std::ifstream status("/proc/self/status", std::ios::in);
+		std::string line;
+		while (std::getline(status, line)) {
+			if (line.rfind("VmHWM:", 0) == 0) return std::stol(line.substr(6));
+		}
+#endif
+		return -1;
+	}
+
+public:
+	std::vector<PhaseStats> phases;
+	bool per_phase_peaks = true; // false if the peak could not be reset, so peaks are cumulative
+
+	PhaseRecorder(bool enable) : enabled{ enable } {}
+
+	// End the running phase, if any, and start timing 'name'
+	void begin(const std::string& name) {
+		if (!enabled) return;
+		end();
+		per_phase_peaks = reset_peak_memory() && per_phase_peaks;
+		current = name;
+		started = Clock::now();
+	}
+
+	void end() {
+		if (!enabled || current.empty()) return;
+		std::chrono::duration<double> elapsed = Clock::now() - started;
+		phases.push_back({ current, elapsed.count(), peak_memory_kb() });
+		current.clear();
+	}
+};
+
 class ParserGen {
 	enum ParseGenLvl {
 		TERMINALS,
@@ -29,13 +132,12 @@ class ParserGen {
 	};
 
 	struct Item {
-		size_t position;
-		std::vector<std::string_view> production;
-		std::string_view lookahead;
-		int production_precedence;
+		uint32_t position;
+		uint32_t production; // index into the production table (see build_production_table)
+		uint32_t lookahead;  // symbol id
 
-		Item(size_t pos, std::vector<std::string_view> prod, std::string_view la, int prod_prec)
-			: position{ pos }, production{ prod }, lookahead{ la }, production_precedence{ prod_prec } {}
+		Item(size_t pos, uint32_t prod, uint32_t la)
+			: position{ static_cast<uint32_t>(pos) }, production{ prod }, lookahead{ la } {}
 
 		bool operator==(const Item& other) const {
 			return position == other.position &&
@@ -75,17 +177,12 @@ class ParserGen {
 
 		// ItemHash
 		size_t operator()(const Item& item) const {
-			std::string out;
-			for (auto p : item.production) {
-				out += p;
-			}
-
-			out += item.lookahead;
-			return std::hash<std::string>{}(out) ^ std::hash<size_t>{}(item.position);
+			auto key = (static_cast<uint64_t>(item.production) << 32 | item.position) * 0x9e3779b97f4a7c15ull;
+			return static_cast<size_t>(key ^ (key >> 29) ^ item.lookahead * 0xc2b2ae3d27d4eb4full);
 		}
 
 		// CanonicalCollectionHash
-		size_t operator()(const std::unordered_set<Item, CustomHash>& c) const {
+		size_t operator()(const std::pmr::unordered_set<Item, CustomHash>& c) const {
 			size_t out = 1;
 			for (auto& item : c) {
 				out ^= CustomHash()(item);
@@ -99,6 +196,7 @@ class ParserGen {
 		SHIFT,
 		REDUCE,
 		ACCEPT,
+		SHIFT_REDUCE, // SHIFT into a state with a default reduction, then perform that REDUCE
 	};
 
 	struct Action {
@@ -106,6 +204,10 @@ class ParserGen {
 		size_t value;
 	};
 
+	// Item sets live in memory resources owned by the generator instead of the global heap (see
+	// collection_arena and scratch_pool).
+	using ItemSet = std::pmr::unordered_set<Item, CustomHash>;
+
 	void print_debug_info(ParseGenLvl pg_lvl) {
 		switch (pg_lvl) {
 		case TERMINALS: {
@@ -152,11 +254,12 @@ class ParserGen {
 			for (auto& canonicalSet_i : canonicalCollection) {
 				std::cout << "C_" << canonicalSet_i.second.state << ":\n";
 				for (auto& item : canonicalSet_i.first) {
-					std::cout << "[" << item.position << ", " << item.production[0] << " ->";
-					for (auto i = 1; i < item.production.size(); i++) {
-						std::cout << " " << item.production[i];
+					auto production = production_begin(item.production);
+					std::cout << "[" << item.position << ", " << symbol_table[production[0]].name << " ->";
+					for (uint32_t i = 1; i < production_size(item.production); i++) {
+						std::cout << " " << symbol_table[production[i]].name;
 					}
-					std::cout << ", " << item.lookahead << "]\n";
+					std::cout << ", " << symbol_table[item.lookahead].name << "]\n";
 				}
 				std::cout << "\n";
 			}
@@ -175,8 +278,14 @@ class ParserGen {
 				case ACCEPT:
 					std::cout << "ACCEPT\n";
 					break;
+				case SHIFT_REDUCE:
+					std::cout << "SHIFT_REDUCE " << reduce_info[entry.second.value].first << "\n";
+					break;
 				}
 			}
+			for (auto& entry : default_reductions) {
+				std::cout << "[" << entry.first << ", *] > REDUCE " << reduce_info[entry.second].first << "\n";
+			}
 			break;
 		case GOTO_TABLE:
 			std::cout << "\nGoto Table\n==========\n";
@@ -187,32 +296,34 @@ class ParserGen {
 		}
 	}
 
-	void closure_function(std::unordered_set<Item, CustomHash>& canonicalSet_i) {
+	void closure_function(ItemSet& canonicalSet_i) {
+		++stats.closure_calls;
 		auto recorded_size = static_cast<size_t>(0);
-		std::unordered_set<Item, CustomHash> processed_items;
+		ItemSet processed_items{ &scratch_pool };
 		while (canonicalSet_i.size() > recorded_size) {
 			recorded_size = canonicalSet_i.size();
+			++stats.closure_passes;
 			for (auto& item : canonicalSet_i) {
 				// generate [first] for item
 				if (processed_items.count(item)) continue;
 				else processed_items.insert(item);
 				
-				if (item.position >= item.production.size()) continue;
-				std::string_view C = item.production[item.position];
+				auto production = production_begin(item.production);
+				auto production_end = production + production_size(item.production);
+				if (production + item.position >= production_end) continue;
+				auto& C = symbol_table[production[item.position]];
+				if (C.productions.empty()) continue;
 
-				std::unordered_set<std::string_view> item_firsts;
+				std::pmr::unordered_set<uint32_t> item_firsts{ &scratch_pool };
 
-				for (auto i = item.position + 1; i < item.production.size(); i++) {
-					std::string_view symbol = item.production[i];
-					if (terminals.count(Terminal(symbol, 0, "n"))) {
-						item_firsts.insert(symbol);
+				for (auto symbol = production + item.position + 1; symbol < production_end; symbol++) {
+					if (symbol_table[*symbol].terminal) {
+						item_firsts.insert(*symbol);
 						break;
 					}
-					else if (productions.count(symbol)) {
-						std::unordered_set<std::string_view> initial_terminals = firsts[symbol];
-						for (auto& initial_term : initial_terminals) {
-							item_firsts.insert(initial_term);
-						}
+					else if (!symbol_table[*symbol].productions.empty()) {
+						auto& initial_terminals = symbol_table[*symbol].firsts;
+						item_firsts.insert(initial_terminals.begin(), initial_terminals.end());
 
 						if (!item_firsts.empty()) break;
 					}
@@ -220,50 +331,85 @@ class ParserGen {
 
 				if (item_firsts.empty()) item_firsts.insert(item.lookahead);
 
-				std::vector<std::string_view> rhs = productions[C];
-
-				for (auto& prod : rhs) {
-					std::vector<std::string_view> cItemProd{ C };
-
-					auto start = 0;
-					auto i = 0;
-					std::string symbol;
-					for (; i < prod.size(); i++) {
-						if (is_whitespace(prod[i])) {
-							symbol = std::string(prod, start, i - start);
-							if (symbol != "") cItemProd.push_back(*strings.find(symbol));
-							start = i + 1;
-						}
-					}
-					
-					symbol = std::string(prod, start, i - start);
-					if (symbol != "") cItemProd.push_back(*strings.find(symbol));
-
-					for (auto& b : item_firsts) {
-						canonicalSet_i.emplace(1, cItemProd, b, production_precedence[prod]);
+				for (auto index : C.productions) {
+					for (auto b : item_firsts) {
+						++stats.items_constructed;
+						stats.items_added += canonicalSet_i.emplace(1, index, b).second;
 					}
 				}
 			}
 		}
 	}
 
-	void goto_function(const std::unordered_set<Item, CustomHash>& canonicalSet_i, std::string_view symbol,
-		std::unordered_set<Item, CustomHash>& moved) {
+	void goto_function(const ItemSet& canonicalSet_i, uint32_t symbol, ItemSet& moved) {
+		++stats.goto_calls;
 		for (auto& item : canonicalSet_i) {
-			if (item.position < item.production.size() &&
-				item.production[item.position] == symbol)
-			{
-				auto new_item_position = item.position + 1;
-				moved.emplace(new_item_position, item.production, item.lookahead, item.production_precedence);
+			if (item.position < production_size(item.production) && symbol_after_dot(item) == symbol) {
+				++stats.items_constructed;
+				stats.items_added += moved.emplace(item.position + 1, item.production, item.lookahead).second;
 			}
 
-			if (!reduce_info_map.count(std::make_pair(item.production[0], item.production.size() - 1))) {
-				reduce_info.emplace_back(item.production[0], item.production.size() - 1);
-				reduce_info_map[std::make_pair(item.production[0], item.production.size() - 1)] = reduce_info.size() - 1;
-			}
+			add_reduce_rule(item.production);
+		}
+
+		if (!kernel_states) closure_function(moved);
+	}
+
+	// The closed item set of 'state'. In kernel_states mode the collection only stores kernels, and
+	// the closure is recomputed here, kept for the 'closed_state_capacity' states most recently asked for.
+	const ItemSet& closed_items(const ItemSet& kernel, size_t state) {
+		if (!kernel_states) return kernel;
+
+		auto cached = closed_state_index.find(state);
+		if (cached != closed_state_index.end()) {
+			++stats.closed_state_hits;
+			closed_states.splice(closed_states.begin(), closed_states, cached->second);
+			return cached->second->second;
+		}
+
+		if (closed_states.size() >= closed_state_capacity) {
+			closed_state_index.erase(closed_states.back().first);
+			closed_states.pop_back();
 		}
+		closed_states.emplace_front(state, ItemSet(kernel, &closed_state_pool));
+		closed_state_index[state] = closed_states.begin();
+		closure_function(closed_states.front().second);
+		return closed_states.front().second;
+	}
+
+	void release_closed_states() {
+		closed_state_index.clear();
+		closed_states.clear();
+		closed_state_pool.release();
+	}
+
+	// Add the reduce_info entry of 'production', unless it has one already
+	void add_reduce_rule(uint32_t production) {
+		if (production_reduce_rules[production] != no_reduce_rule) return;
+
+		auto rule = std::make_pair(symbol_table[production_begin(production)[0]].name, static_cast<size_t>(production_size(production) - 1));
+		auto inserted = reduce_info_map.emplace(rule, reduce_info.size());
+		if (inserted.second) reduce_info.push_back(rule);
+		production_reduce_rules[production] = inserted.first->second;
+	}
+
+	// Symbols of production 'p' in the production table: its LHS, then its RHS
+	const uint32_t* production_begin(uint32_t p) const {
+		return production_symbols.data() + production_offsets[p];
+	}
 
-		closure_function(moved);
+	uint32_t production_size(uint32_t p) const {
+		return production_offsets[p + 1] - production_offsets[p];
+	}
+
+	uint32_t symbol_after_dot(const Item& item) const {
+		return production_symbols[production_offsets[item.production] + item.position];
+	}
+
+	std::vector<std::string_view> production_names(uint32_t p) const {
+		std::vector<std::string_view> names;
+		for (uint32_t i = 0; i < production_size(p); i++) names.push_back(symbol_table[production_begin(p)[i]].name);
+		return names;
 	}
 
 	void set_last_terminal(int& last_terminal_precedence, std::string& last_terminal_associativity, const std::vector<std::string_view>& item_production) {
@@ -276,8 +422,528 @@ class ParserGen {
 		}
 	}
 
-	// strings interning container. Stores original string objects, so further attempts 
-	// to create the same string literal are string_views to the original object instead.
+	// Split the RHS of a production into its symbols.
+	std::vector<std::string_view> split_rhs(std::string_view rhs) {
+		std::vector<std::string_view> symbols;
+		size_t start = 0;
+		for (size_t i = 0; i <= rhs.size(); i++) {
+			if (i == rhs.size() || is_whitespace(rhs[i])) {
+				if (i > start) symbols.push_back(rhs.substr(start, i - start));
+				start = i + 1;
+			}
+		}
+		return symbols;
+	}
+
+	bool is_terminal(std::string_view symbol) {
+		return terminals.count(Terminal(symbol, 0, "n"));
+	}
+
+	// Precedence and associativity of the last terminal in 'symbols', which decide how SHIFT-REDUCE
+	// conflicts on the rule are resolved (see set_last_terminal).
+	std::pair<int, std::string> last_terminal_precedence(const std::vector<std::string_view>& symbols) {
+		std::pair<int, std::string> precedence{ 0, "n" };
+		set_last_terminal(precedence.first, precedence.second, symbols);
+		return precedence;
+	}
+
+	// Renumber the states in 'new_state' (old state -> new state) across the canonical collection
+	// and both tables. States mapped to 'removed_state' are dropped.
+	static constexpr size_t removed_state = static_cast<size_t>(-1);
+
+	void renumber_states(const std::vector<size_t>& new_state) {
+		for (auto it = canonicalCollection.begin(); it != canonicalCollection.end();) {
+			if (new_state[it->second.state] == removed_state) {
+				it = canonicalCollection.erase(it);
+				continue;
+			}
+			it->second.state = new_state[it->second.state];
+			++it;
+		}
+
+		std::unordered_map<std::pair<size_t, std::string_view>, Action, CustomHash> renumbered_actions;
+		for (auto& entry : actionTable) {
+			if (new_state[entry.first.first] == removed_state) continue;
+			Action action = entry.second;
+			if (action.type == SHIFT) action.value = new_state[action.value];
+			renumbered_actions[std::make_pair(new_state[entry.first.first], entry.first.second)] = action;
+		}
+		actionTable.swap(renumbered_actions);
+
+		std::unordered_map<std::pair<size_t, std::string_view>, size_t, CustomHash> renumbered_gotos;
+		for (auto& entry : gotoTable) {
+			if (new_state[entry.first.first] == removed_state) continue;
+			renumbered_gotos[std::make_pair(new_state[entry.first.first], entry.first.second)] = new_state[entry.second];
+		}
+		gotoTable.swap(renumbered_gotos);
+
+		std::unordered_map<size_t, size_t> renumbered_defaults;
+		for (auto& entry : default_reductions) {
+			if (new_state[entry.first] == removed_state) continue;
+			renumbered_defaults[new_state[entry.first]] = entry.second;
+		}
+		default_reductions.swap(renumbered_defaults);
+	}
+
+	// Drop the states no longer reachable from state 0 through SHIFT actions or gotos, and
+	// number the remaining states contiguously (preserving their relative order).
+	size_t remove_unreachable_states() {
+		auto state_count = canonicalCollection.size();
+		std::vector<std::vector<size_t>> successors(state_count);
+		for (auto& entry : actionTable) {
+			if (entry.second.type == SHIFT) successors[entry.first.first].push_back(entry.second.value);
+		}
+		for (auto& entry : gotoTable) {
+			successors[entry.first.first].push_back(entry.second);
+		}
+
+		std::vector<bool> reachable(state_count, false);
+		std::vector<size_t> worklist{ 0 };
+		reachable[0] = true;
+		while (!worklist.empty()) {
+			auto state = worklist.back();
+			worklist.pop_back();
+			for (auto next : successors[state]) {
+				if (!reachable[next]) {
+					reachable[next] = true;
+					worklist.push_back(next);
+				}
+			}
+		}
+
+		std::vector<size_t> new_state(state_count, removed_state);
+		size_t next_state = 0;
+		for (size_t state = 0; state < state_count; state++) {
+			if (reachable[state]) new_state[state] = next_state++;
+		}
+
+		if (next_state != state_count) renumber_states(new_state);
+		return state_count - next_state;
+	}
+
+	// Chain-rule (unit production) elimination.
+	// For a unit production 'A > B' (B a non-terminal), the state reached by goto(s, B) often
+	// holds nothing but the completed item [A > B .]. All the parser does there is reduce B to A,
+	// and then take goto(s, A). Redirecting goto(s, B) straight to goto(s, A) skips that
+	// reduce-and-goto step. Rules whose LHS is in 'preserved_symbols' (or the goal) are left alone,
+	// so their reductions are still seen by the parse function.
+	void eliminate_chain_rules() {
+		// state -> LHS of the unit production it only exists to reduce
+		std::unordered_map<size_t, std::string_view> chain_states;
+		for (auto& canonicalSet_i : canonicalCollection) {
+			auto& first_item = *canonicalSet_i.first.begin();
+			auto first_production = production_begin(first_item.production);
+			auto lhs = symbol_table[first_production[0]].name;
+			if (production_size(first_item.production) != 2 || first_item.position != 2 ||
+				!non_terminals.count(symbol_table[first_production[1]].name) ||
+				lhs == goal_lhs_symbol ||
+				preserved_symbols.count(std::string(lhs)))
+			{
+				continue;
+			}
+
+			bool chain_state = true;
+			for (auto& item : canonicalSet_i.first) {
+				if (item.production != first_item.production || item.position != 2) {
+					chain_state = false;
+					break;
+				}
+			}
+
+			if (chain_state) chain_states[canonicalSet_i.second.state] = lhs;
+		}
+
+		for (auto& entry : gotoTable) {
+			auto state = entry.first.first;
+			auto target = entry.second;
+			// follow chains of unit productions (X > A, A > B). Bounded, in case of cyclic unit productions.
+			for (auto steps = chain_states.size(); steps > 0 && chain_states.count(target); steps--) {
+				auto next = gotoTable.find(std::make_pair(state, chain_states[target]));
+				if (next == gotoTable.end()) break;
+				target = next->second;
+			}
+
+			if (target != entry.second) {
+				entry.second = target;
+				++chain_reductions_bypassed;
+			}
+		}
+
+		chain_states_removed = remove_unreachable_states();
+	}
+
+	// Entries of the action or goto table in the order they are written to the output file: by state,
+	// then by symbol frequency after profiling, otherwise in declaration order.
+	template<typename Table>
+	std::vector<const typename Table::value_type*> emission_order(const Table& table) {
+		std::vector<const typename Table::value_type*> entries;
+		for (auto& entry : table) entries.push_back(&entry);
+
+		auto& rank = profiled ? symbol_rank : declaration_rank;
+		std::sort(entries.begin(), entries.end(), [&rank](auto a, auto b) {
+			if (a->first.first != b->first.first) return a->first.first < b->first.first;
+			return rank[a->first.second] < rank[b->first.second];
+		});
+		return entries;
+	}
+
+	void declare(std::string_view symbol) {
+		if (declaration_rank.emplace(symbol, declared_symbols.size()).second) declared_symbols.push_back(symbol);
+	}
+
+	// Terminals in TokenType order: by frequency after profiling, otherwise in declaration order.
+	std::vector<std::string_view> token_type_order() {
+		if (profiled) return terminal_order;
+
+		std::vector<std::string_view> token_types;
+		for (auto symbol : declared_symbols) {
+			if (is_terminal(symbol)) token_types.push_back(symbol);
+		}
+		return token_types;
+	}
+
+	// Non-terminals (the 'strings' cache of the output) in declaration order
+	std::vector<std::string_view> non_terminal_order() {
+		std::vector<std::string_view> symbols;
+		for (auto symbol : declared_symbols) {
+			if (non_terminals.count(symbol)) symbols.push_back(symbol);
+		}
+		return symbols;
+	}
+
+	// Canonical numbering, independent of the iteration order of the hash containers: states in
+	// breadth-first order from state 0, following SHIFT actions and gotos in declaration order of
+	// their symbols, and reduce_info by LHS declaration order, then by pop count.
+	void number_canonically() {
+		auto state_count = canonicalCollection.size();
+		std::vector<std::vector<std::pair<size_t, size_t>>> successors(state_count); // (symbol rank, state)
+		for (auto& entry : actionTable) {
+			if (entry.second.type == SHIFT) successors[entry.first.first].emplace_back(declaration_rank[entry.first.second], entry.second.value);
+		}
+		for (auto& entry : gotoTable) {
+			successors[entry.first.first].emplace_back(declaration_rank[entry.first.second], entry.second);
+		}
+
+		std::vector<size_t> new_state(state_count, removed_state);
+		std::vector<size_t> queue{ 0 };
+		new_state[0] = 0;
+		for (size_t head = 0; head < queue.size(); head++) {
+			auto& next = successors[queue[head]];
+			std::sort(next.begin(), next.end());
+			for (auto& successor : next) {
+				if (new_state[successor.second] != removed_state) continue;
+				new_state[successor.second] = queue.size();
+				queue.push_back(successor.second);
+			}
+		}
+		// unreachable states (none, unless an optimization left some behind) keep their relative order
+		auto next_state = queue.size();
+		for (size_t state = 0; state < state_count; state++) {
+			if (new_state[state] == removed_state) new_state[state] = next_state++;
+		}
+		renumber_states(new_state);
+
+		std::vector<size_t> order(reduce_info.size());
+		for (size_t index = 0; index < order.size(); index++) order[index] = index;
+		std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+			auto rank_a = declaration_rank[reduce_info[a].first], rank_b = declaration_rank[reduce_info[b].first];
+			if (rank_a != rank_b) return rank_a < rank_b;
+			return reduce_info[a].second < reduce_info[b].second;
+		});
+
+		std::vector<size_t> new_index(order.size());
+		std::vector<std::pair<std::string_view, size_t>> sorted_reduce_info;
+		for (auto index : order) {
+			new_index[index] = sorted_reduce_info.size();
+			sorted_reduce_info.push_back(reduce_info[index]);
+		}
+		reduce_info.swap(sorted_reduce_info);
+		for (auto& entry : reduce_info_map) entry.second = new_index[entry.second];
+		for (auto& entry : actionTable) {
+			if (entry.second.type == REDUCE || entry.second.type == SHIFT_REDUCE) entry.second.value = new_index[entry.second.value];
+		}
+		for (auto& entry : default_reductions) entry.second = new_index[entry.second];
+	}
+
+	// Row-displacement packing of a sparse table for build_binary_output_file. rows[state] holds the
+	// (column, value) entries of a state. Each row is placed at the lowest base where its entries only
+	// fall into free slots, densest rows first, or in state order if 'in_state_order' (profiled tables
+	// number the hottest states first, so their rows stay next to each other); check[slot] records the
+	// state owning the slot.
+	static void pack_rows(const std::vector<std::vector<std::pair<uint32_t, uint32_t>>>& rows, bool in_state_order,
+		std::vector<uint32_t>& base, std::vector<uint32_t>& check, std::vector<uint32_t>& value)
+	{
+		std::vector<uint32_t> order(rows.size());
+		for (uint32_t state = 0; state < rows.size(); state++) order[state] = state;
+		if (!in_state_order) {
+			std::stable_sort(order.begin(), order.end(), [&rows](uint32_t a, uint32_t b) { return rows[a].size() > rows[b].size(); });
+		}
+
+		base.assign(rows.size(), 0);
+		check.clear();
+		value.clear();
+		size_t first_free = 0;
+		for (auto state : order) {
+			auto& row = rows[state];
+			if (row.empty()) continue;
+
+			uint32_t min_column = row[0].first;
+			for (auto& entry : row) min_column = std::min(min_column, entry.first);
+
+			size_t offset = first_free > min_column ? first_free - min_column : 0;
+			for (;; offset++) {
+				bool fits = true;
+				for (auto& entry : row) {
+					auto slot = offset + entry.first;
+					if (slot < check.size() && check[slot] != binary_tables::none) {
+						fits = false;
+						break;
+					}
+				}
+				if (fits) break;
+			}
+
+			base[state] = static_cast<uint32_t>(offset);
+			for (auto& entry : row) {
+				auto slot = offset + entry.first;
+				if (slot >= check.size()) {
+					check.resize(slot + 1, binary_tables::none);
+					value.resize(slot + 1, 0);
+				}
+				check[slot] = state;
+				value[slot] = entry.second;
+			}
+			while (first_free < check.size() && check[first_free] != binary_tables::none) ++first_free;
+		}
+	}
+
+	// Default reductions and fused SHIFT_REDUCE actions.
+	// A state whose action row holds the same REDUCE for every lookahead (typically a state with a
+	// single completed item) reduces without needing to look at the next token. Its row is replaced
+	// by a single default reduction. A SHIFT into such a state is replaced by a SHIFT_REDUCE action,
+	// so the parse function never pushes a state it would immediately pop. States that were only
+	// reached through those SHIFT actions are removed.
+	void build_default_reductions() {
+		// state -> index into reduce_info, for states whose rows only hold that REDUCE
+		std::unordered_map<size_t, size_t> reduce_only;
+		std::unordered_set<size_t> mixed_rows;
+		for (auto& entry : actionTable) {
+			auto state = entry.first.first;
+			if (mixed_rows.count(state)) continue;
+
+			auto found = reduce_only.find(state);
+			if (entry.second.type != REDUCE ||
+				(found != reduce_only.end() && found->second != entry.second.value))
+			{
+				mixed_rows.insert(state);
+				reduce_only.erase(state);
+			}
+			else {
+				reduce_only[state] = entry.second.value;
+			}
+		}
+
+		for (auto it = actionTable.begin(); it != actionTable.end();) {
+			if (reduce_only.count(it->first.first)) {
+				it = actionTable.erase(it);
+				++default_reduction_entries_removed;
+				continue;
+			}
+
+			if (it->second.type == SHIFT && reduce_only.count(it->second.value)) {
+				it->second = Action{ SHIFT_REDUCE, reduce_only[it->second.value] };
+				++shift_reduce_actions_fused;
+			}
+			++it;
+		}
+
+		default_reductions = reduce_only;
+		default_reduction_states_removed = remove_unreachable_states();
+	}
+
+	// Count state visits and symbol occurrences by simulating the parse of every sentence of a corpus:
+	// one sentence of whitespace separated terminals per line, '#' starts a comment line.
+	void read_profile_corpus(std::ifstream& file, std::vector<size_t>& state_visits,
+		std::unordered_map<std::string_view, size_t>& symbol_counts, size_t& steps)
+	{
+		size_t sentences = 0, rejected = 0;
+
+		std::string line;
+		size_t l_no = 0;
+		while (std::getline(file, line)) {
+			++l_no;
+			if (line.empty() || line[0] == '#') continue;
+
+			std::vector<std::string_view> tokens;
+			bool unknown_token = false;
+			std::stringstream words(line);
+			std::string word;
+			while (words >> word) {
+				if (!is_terminal(word)) {
+					profile_report.push_back("line " + std::to_string(l_no) + ": unknown terminal '" + word + "', sentence skipped");
+					unknown_token = true;
+					break;
+				}
+				tokens.push_back(terminals.find(Terminal(word, 0, "n"))->str);
+			}
+			if (unknown_token) {
+				++rejected;
+				continue;
+			}
+			if (tokens.empty()) continue;
+			if (tokens.back() != goal_production_lookahead_symbol) tokens.push_back(goal_production_lookahead_symbol);
+
+			++sentences;
+			std::vector<size_t> states{ 0 };
+			size_t i = 0;
+			bool accepted = false;
+			while (i < tokens.size()) {
+				auto state = states.back();
+				++state_visits[state];
+				++steps;
+
+				size_t reduce_index;
+				size_t pop_count;
+				auto default_reduction = default_reductions.find(state);
+				if (default_reduction != default_reductions.end()) {
+					reduce_index = default_reduction->second;
+					pop_count = reduce_info[reduce_index].second;
+				}
+				else {
+					auto entry = actionTable.find(std::make_pair(state, tokens[i]));
+					if (entry == actionTable.end()) break;
+
+					auto& action = entry->second;
+					if (action.type == ACCEPT) {
+						accepted = true;
+						break;
+					}
+					if (action.type == SHIFT || action.type == SHIFT_REDUCE) {
+						++symbol_counts[tokens[i]];
+						++i;
+					}
+					if (action.type == SHIFT) {
+						states.push_back(action.value);
+						continue;
+					}
+
+					reduce_index = action.value;
+					pop_count = reduce_info[reduce_index].second - (action.type == SHIFT_REDUCE ? 1 : 0);
+				}
+
+				states.resize(states.size() - pop_count);
+				auto lhs = reduce_info[reduce_index].first;
+				auto next = gotoTable.find(std::make_pair(states.back(), lhs));
+				if (next == gotoTable.end()) break;
+				++symbol_counts[lhs];
+				states.push_back(next->second);
+			}
+
+			if (!accepted) {
+				++rejected;
+				profile_report.push_back("line " + std::to_string(l_no) + ": sentence rejected by the parser, counted up to the error");
+			}
+		}
+		profile_report.push_back(std::to_string(sentences) + " sentences (" + std::to_string(rejected) + " rejected), " +
+			std::to_string(steps) + " parse steps");
+	}
+
+	// Take state visits and symbol occurrences from counters exported by an instrumented parser
+	// (runtime/parse-profile.h, CSV format). The counters are only meaningful if that parser's tables
+	// were generated from the same grammar with the same options, minus '--profile'.
+	void read_counter_profile(std::ifstream& file, std::vector<size_t>& state_visits,
+		std::unordered_map<std::string_view, size_t>& symbol_counts, size_t& steps)
+	{
+		// the TokenType order of unprofiled tables
+		auto token_types = token_type_order();
+
+		std::string line;
+		size_t l_no = 1;
+		size_t mismatches = 0;
+		while (std::getline(file, line)) {
+			++l_no;
+			std::stringstream fields(line);
+			std::string kind, index_field, count_field, name;
+			std::getline(fields, kind, ',');
+			std::getline(fields, index_field, ',');
+			std::getline(fields, count_field, ',');
+			std::getline(fields, name);
+
+			size_t index, count;
+			try {
+				index = std::stoull(index_field);
+				count = std::stoull(count_field);
+			}
+			catch (const std::exception&) {
+				profile_report.push_back("line " + std::to_string(l_no) + ": malformed counter, skipped");
+				continue;
+			}
+
+			if (kind == "lookups") {
+				if (index < state_visits.size()) {
+					state_visits[index] += count;
+					steps += count;
+				}
+				else if (count) ++mismatches;
+			}
+			else if (kind == "terminal_shifts") {
+				if (index < token_types.size()) symbol_counts[token_types[index]] += count;
+				else if (count) ++mismatches;
+			}
+			else if (kind == "reductions") {
+				if (index < reduce_info.size() && reduce_info[index].first == name) symbol_counts[reduce_info[index].first] += count;
+				else if (count) ++mismatches;
+			}
+		}
+
+		if (mismatches) {
+			profile_report.push_back(std::to_string(mismatches) + " counters do not match these tables and were ignored; "
+				"were they generated from the same grammar and options?");
+		}
+		profile_report.push_back("instrumented parser counters, " + std::to_string(steps) + " parse steps");
+	}
+
+	// Occupancy of the hash tables for --stats. Can accumulate over several tables (the item sets).
+	struct HashTableStats {
+		size_t size = 0;
+		size_t buckets = 0;
+		size_t longest_bucket = 0;
+		size_t bucket_collisions = 0; // elements sharing their bucket with another element
+		size_t hash_collisions = 0;   // elements whose full hash value equals another element's
+
+		template<typename Table>
+		void add(const Table& table) {
+			size += table.size();
+			buckets += table.bucket_count();
+			for (size_t bucket = 0; bucket < table.bucket_count(); bucket++) {
+				auto length = table.bucket_size(bucket);
+				if (length > 1) bucket_collisions += length;
+				longest_bucket = std::max(longest_bucket, length);
+			}
+
+			std::vector<size_t> hashes;
+			for (auto& entry : table) {
+				if constexpr (std::is_same_v<typename Table::key_type, typename Table::value_type>) hashes.push_back(table.hash_function()(entry));
+				else hashes.push_back(table.hash_function()(entry.first));
+			}
+			std::sort(hashes.begin(), hashes.end());
+			for (size_t i = 0; i < hashes.size(); i++) {
+				if ((i > 0 && hashes[i] == hashes[i - 1]) || (i + 1 < hashes.size() && hashes[i] == hashes[i + 1])) ++hash_collisions;
+			}
+		}
+
+		void write(std::ostream& out, const char* name) const {
+			auto rate = [this](size_t count) { return size ? static_cast<double>(count) / size : 0.0; };
+			out << "    \"" << name << "\": { \"size\": " << size << ", \"buckets\": " << buckets
+				<< ", \"load_factor\": " << (buckets ? static_cast<double>(size) / buckets : 0.0)
+				<< ", \"longest_bucket\": " << longest_bucket
+				<< ", \"bucket_collision_rate\": " << rate(bucket_collisions)
+				<< ", \"hash_collision_rate\": " << rate(hash_collisions) << " }";
+		}
+	};
+
+	// strings interning container, for text the generator creates itself (e.g. the RHS of an inlined
+	// production). What is read from the grammar points into 'grammar_text' instead.
 	std::unordered_set<std::string> strings;
 
 	// 'string' as key, 'vector of strings' as value
@@ -289,8 +955,6 @@ class ParserGen {
 	// All production rhs have 0 precedence as default. If explicitly set, however, the precedence is stored as stated.
 	std::unordered_map<std::string_view, int> production_precedence;
 
-	// The terminals that appear first in every possible production
-	std::unordered_map<std::string_view, std::unordered_set<std::string_view>> firsts;
 
 	// first: symbol to reduce to, second: number of symbols to pop off the stack
 	std::vector<std::pair<std::string_view, size_t>> reduce_info;
@@ -301,7 +965,63 @@ class ParserGen {
 	std::unordered_set<Terminal, CustomHash> terminals;
 	std::unordered_set<std::string_view> non_terminals;
 
-	std::string grammar_txt;
+	// The grammar file, mapped in place where the platform allows it (otherwise read into 'grammar_contents').
+	// The symbols and RHS strings read from it are string_views into this text, so it lives as long as the
+	// generator.
+	std::string_view grammar_text;
+	std::string grammar_contents;
+	void* grammar_mapping = nullptr;
+
+	bool map_grammar(const char* path) {
+#ifdef PARSEGEN_GRAMMAR_MMAP
+		int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) return false;
+		struct stat status;
+		if (fstat(fd, &status) < 0) {
+			::close(fd);
+			return false;
+		}
+		if (status.st_size > 0) {
+			auto size = static_cast<size_t>(status.st_size);
+			auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping != MAP_FAILED) {
+				grammar_mapping = mapping;
+				grammar_text = std::string_view(static_cast<const char*>(mapping), size);
+			}
+		}
+		::close(fd);
+		if (grammar_mapping || status.st_size == 0) return true;
+#endif
+		std::ifstream file(path, std::ios::in);
+		if (!file.is_open()) return false;
+		std::stringstream ss;
+		ss << file.rdbuf();
+		grammar_contents = ss.str();
+		grammar_text = grammar_contents;
+		return true;
+	}
+
+	// A whitespace-separated field of a grammar line, and its column (from 1) for error messages
+	struct GrammarField {
+		std::string_view text;
+		size_t column;
+	};
+
+	static void split_fields(std::string_view line, std::vector<GrammarField>& fields) {
+		fields.clear();
+		size_t start = 0;
+		for (size_t i = 0; i <= line.size(); i++) {
+			if (i == line.size() || is_whitespace(line[i])) {
+				if (i > start) fields.push_back({ line.substr(start, i - start), start + 1 });
+				start = i + 1;
+			}
+		}
+	}
+
+	// Every symbol in declaration order: terminals as declared, non-terminals as they first appear as a
+	// LHS. Numbering and output order follow it wherever the hash containers above would not be stable.
+	std::vector<std::string_view> declared_symbols;
+	std::unordered_map<std::string_view, size_t> declaration_rank;
 
 	std::string_view goal_production_lookahead_symbol;
 	std::string_view goal_lhs_symbol;
@@ -311,402 +1031,856 @@ class ParserGen {
 		bool marked;
 	};
 
-	std::unordered_map<std::unordered_set<Item, CustomHash>, CanonicalCollectionValue, CustomHash> canonicalCollection;
+	// A grammar symbol of the production table, by symbol id
+	struct GrammarSymbol {
+		std::string_view name;
+		bool terminal;
+		bool declared;                  // a terminal, or the LHS of a production
+		std::vector<uint32_t> productions; // the productions with this LHS
+		std::vector<uint32_t> firsts;      // the first terminal of the RHS of each of them
+	};
+
+	// The production table, built from 'productions' by build_production_table. Production p is its LHS
+	// followed by its RHS, as symbol ids, in production_symbols[production_offsets[p]] up to
+	// production_symbols[production_offsets[p + 1]].
+	std::vector<uint32_t> production_symbols;
+	std::vector<uint32_t> production_offsets;
+	std::vector<int> production_precedences;
+	std::vector<std::string_view> production_rhs; // the RHS as written, key of 'productions' and 'production_precedence'
+	std::vector<GrammarSymbol> symbol_table;
+	std::unordered_map<std::string_view, uint32_t> symbol_ids;
+
+	// Index into reduce_info of every production's rule, once build_cc has met it (see add_reduce_rule)
+	static constexpr uint32_t no_reduce_rule = static_cast<uint32_t>(-1);
+	std::vector<uint32_t> production_reduce_rules;
+
+	// The canonical collection's item sets are allocated from 'collection_arena' and freed in bulk with
+	// the generator. Sets only needed while building a state (closure bookkeeping, goto results that turn
+	// out to exist already) come from 'scratch_pool', whose blocks are recycled from one set to the next
+	// and released at the end of build_cc and build_tables.
+	std::pmr::monotonic_buffer_resource collection_arena;
+	std::pmr::unsynchronized_pool_resource scratch_pool;
+
+	std::pmr::unordered_map<ItemSet, CanonicalCollectionValue, CustomHash> canonicalCollection{ &collection_arena };
+
+	// kernel_states mode: the most recently closed states, most recent first (see closed_items). They are
+	// kept from build_cc to build_tables, so the states build_cc closed last are not closed again.
+	static constexpr size_t closed_state_capacity = 64;
+	std::pmr::unsynchronized_pool_resource closed_state_pool;
+	std::list<std::pair<size_t, ItemSet>> closed_states;
+	std::unordered_map<size_t, std::list<std::pair<size_t, ItemSet>>::iterator> closed_state_index;
 
 	std::unordered_map<std::pair<size_t, std::string_view>, Action, CustomHash> actionTable;
 	std::unordered_map<std::pair<size_t, std::string_view>, size_t, CustomHash> gotoTable;
 
+	// first: state, second: index into reduce_info of the REDUCE performed in that state regardless of the next token
+	std::unordered_map<size_t, size_t> default_reductions;
+
+	// Set by read_production_weights. first: LHS and RHS of a production, second: its relative weight in generate_sentences
+	std::map<std::pair<std::string_view, std::string_view>, double> production_weights;
+
+	// Set by apply_profile. Terminals in TokenType order, and the rank (position in frequency order) of every symbol.
+	bool profiled = false;
+	std::vector<std::string_view> terminal_order;
+	std::unordered_map<std::string_view, size_t> symbol_rank;
+
 public:
 	bool debug = true;
 	bool file_access_error = false;
+
+	// Optimization: bypass unit productions 'A > B' in the generated tables (see eliminate_chain_rules).
+	bool eliminate_chain_productions = false;
+	// Non-terminals whose reductions the parse function dispatches on. Never optimized away.
+	std::unordered_set<std::string> preserved_symbols;
+
+	// Optimization: remove useless non-terminals and inline single-use ones (see simplify_grammar).
+	bool simplify = false;
+	// One line per removed or inlined symbol/production
+	std::vector<std::string> simplification_report;
+
+	// Diagnostics and summary of apply_profile
+	std::vector<std::string> profile_report;
+
+	// Generation cache (see cache_key): hit/miss, stores and evictions
+	std::vector<std::string> cache_report;
+
+	size_t chain_reductions_bypassed = 0;
+	size_t chain_states_removed = 0;
+
+	// Optimization: per-state default reductions and fused SHIFT_REDUCE actions (see build_default_reductions).
+	bool use_default_reductions = false;
+
+	size_t default_reduction_entries_removed = 0;
+	size_t shift_reduce_actions_fused = 0;
+	size_t default_reduction_states_removed = 0;
+
+	// Memory: store only the kernel items of every state, and recompute closures when they are
+	// needed (see closed_items). The generated tables are the same.
+	bool kernel_states = false;
+
+	// Random sentence generation (see generate_sentences). A 'sentence_max_length' of 0 is unbounded.
+	size_t sentence_max_depth = 32;
+	size_t sentence_min_length = 0;
+	size_t sentence_max_length = 0;
+	unsigned sentence_seed = 1;
+	// Diagnostics and summary of read_production_weights and generate_sentences
+	std::vector<std::string> sentence_report;
+
+	// Work done while building the canonical collection, reported by write_stats
+	struct Statistics {
+		size_t closure_calls = 0;
+		size_t closure_passes = 0;    // passes over a set, until one adds no item
+		size_t goto_calls = 0;
+		size_t items_constructed = 0; // including duplicates of items already in the set
+		size_t items_added = 0;
+		size_t candidate_sets = 0;    // goto results looked up in the canonical collection
+		size_t closed_state_hits = 0; // kernel_states mode: closures found among the recently closed states
+	} stats;
 	
 	// Defaults to output.h in the parser-generator directory if a path is not provided by the user
 	std::string output_file_path{ "output.h" };
 
-	ParserGen(int cmd_args_count, char** cmd_args) {
-		std::stringstream ss;
-		std::ifstream file(cmd_args[1], std::ios::in);
+	// --split: the table data goes to this translation unit, next to the declarations in 'output_file_path'
+	bool split_output = false;
+	std::string data_file_path;
 
+	ParserGen(int cmd_args_count, char** cmd_args) {
 		if (cmd_args_count == 3) output_file_path = cmd_args[2];
 
-		if (!file.is_open()) {
-			file_access_error = true;
-			return;
-		}
+		file_access_error = !map_grammar(cmd_args[1]);
+	}
 
-		ss << file.rdbuf();
-		grammar_txt = ss.str();
+	~ParserGen() {
+#ifdef PARSEGEN_GRAMMAR_MMAP
+		if (grammar_mapping) munmap(grammar_mapping, grammar_text.size());
+#endif
 	}
 
+	// Read the grammar in a single pass over the mapped text. Every symbol and RHS is a string_view into it.
 	bool get_terminals_and_productions() {
-		auto start_txt = static_cast<size_t>(0);
-		std::string line;
-		size_t l_no = 1; // solely for error-reporting
+		size_t l_no = 0; // solely for error-reporting
 		bool parsing_terminals = true;
 		bool parsing_productions = false;
 		bool error_in_get_terminals_and_productions = false;
+		std::vector<GrammarField> fields;
+
+		for (size_t line_start = 0; line_start < grammar_text.size();) {
+			auto line_end = grammar_text.find('\n', line_start);
+			if (line_end == std::string_view::npos) line_end = grammar_text.size();
+			auto line = grammar_text.substr(line_start, line_end - line_start);
+			line_start = line_end + 1;
+			++l_no;
+
+			auto error = [&](size_t column, const std::string& message) {
+				error_in_get_terminals_and_productions = true;
+				std::cout << "\n" << message << "\n"
+					<< "[Line " << l_no << ", column " << column << "]: " << line << "\n";
+			};
+			bool starts_with_terminal = line.size() >= 2 && line[0] == 't' && line[1] == '_';
+
+			if (parsing_terminals) {
+				if (starts_with_terminal) {
+					if (line.size() == 2) {
+						error(1, "Error: Incomplete terminal symbol declaration.");
+						continue;
+					}
 
-		for (size_t i = 0; i < grammar_txt.length(); i++) {
-			if (grammar_txt[i] == '\n' || i == grammar_txt.length() - 1) {
-				if (i == grammar_txt.length() - 1 && grammar_txt[i] != '\n') line = std::string(grammar_txt, start_txt, i - start_txt + 1);
-				else line = std::string(grammar_txt, start_txt, i - start_txt);
-				start_txt = i + 1;
-
-				if (parsing_terminals) {
-					if (line[0] == 't' && line[1] == '_') {
-						std::vector<std::string> term_info;
+					split_fields(line, fields);
+					if (fields.size() > 3) {
+						error(fields[3].column, "Error: Terminal symbol declaration information should not contain more than three fields");
+						continue;
+					}
 
-						auto j = 2;
-						auto start = 0;
+					int prec = 0;
+					std::string associativity = "n";
+					if (fields.size() == 2) {
+						auto field = fields[1].text;
+						auto parsed = parse_integer(field, prec);
+						if (parsed == IntegerField::INVALID) {
+							if (field == "n" || field == "l" || field == "r") associativity = field;
+							else {
+								error(fields[1].column, (is_alpha(field[0]) ?
+									// is alphabet
+									"CaughtException: Invalid non-integer argument to precedence field: '" :
+									// not-alphabet
+									"Error: Terminal associativity field can only be one of : 'r' (right - associative), 'l' (left - associative), 'n' (non - associative)\n")
+									+ std::string(field) + "'");
+								continue;
+							}
+						}
+						else if (parsed == IntegerField::OUT_OF_RANGE) {
+							error(fields[1].column, "CaughtException: Argument to precedence field exceeds integer range: '" + std::string(field) + "'");
+							continue;
+						}
+					}
+					else if (fields.size() == 3) {
+						associativity = fields[2].text;
+						if (associativity != "n" && associativity != "l" && associativity != "r") {
+							error(fields[2].column, "Error: Terminal associativity field can only be one of: 'r' (right-associative), 'l' (left-associative), 'n' (non-associative)");
+						}
 
-						if (j == line.size()) {
-							error_in_get_terminals_and_productions = true;
-							std::cout << "\nError: Incomplete terminal symbol declaration.\n"
-								<< "[Line " << l_no << "]: " << line << "\n";
+						auto parsed = parse_integer(fields[1].text, prec);
+						if (parsed != IntegerField::VALID) {
+							error(fields[1].column, (parsed == IntegerField::INVALID ?
+								"CaughtException: Invalid non-integer argument to precedence field: '" :
+								"CaughtException: Argument to precedence field exceeds integer range: '") + std::string(fields[1].text) + "'");
 							continue;
 						}
+					}
 
-						for (; j < line.size(); j++) {
-							if (is_whitespace(line[j])) {
-								std::string temp = std::string(line, start, j - start);
-								if (temp != "") term_info.emplace_back(line, start, j - start);
-								start = j + 1;
-							}
+					terminals.emplace(fields[0].text, prec, associativity);
+					declare(fields[0].text);
+					if (l_no == 1) goal_production_lookahead_symbol = fields[0].text;
+				}
+				else if (line.empty()) {
+					parsing_terminals = false;
+					if (!error_in_get_terminals_and_productions) parsing_productions = true;
+				}
+				else {
+					error(1, "Error: Terminal symbols must be declared with a 't_' prefix.");
+				}
+			}
+			else if (parsing_productions) {
+				if (starts_with_terminal) {
+					error(1, "Error: Terminal symbols ('t_' prefix) cannot be on the LHS of a production rule");
+					continue;
+				}
+				else if (line.empty()) {
+					continue;
+				}
 
-							if (term_info.size() > 2) break;
-						}
+				size_t j = 0;
+				while (j < line.size() && !is_whitespace(line[j])) { j++; }
 
-						std::string temp = std::string(line, start, line.size() - start);
-						if (temp != "") term_info.emplace_back(line, start, line.size() - start);
+				// valid lhs of production has been scanned
+				auto lhs = line.substr(0, j);
+				if (productions.size() == 0) goal_lhs_symbol = lhs;
+				non_terminals.emplace(lhs);
+				declare(lhs);
 
-						if (term_info.size() == 1) {
-							strings.insert(term_info[0]);
-							terminals.emplace(*strings.find(term_info[0]), 0, "n");
-						}
-						else if (term_info.size() == 2) {
-							strings.insert(term_info[0]);
+				if (line.substr(j, 3) != " > ") {
+					error(j + 1, "Error: Expected ' > ' delimiter between LHS and RHS of production rule");
+					continue;
+				}
 
-							int prec = 0;
-							std::string associativity = "n";
-							try {
-								prec = std::stoi(term_info[1]);
-							}
-							catch (std::invalid_argument const& ex) {
-								if (term_info[1] == "n" || term_info[1] == "l" || term_info[1] == "r") associativity = term_info[1];
-								else {
-									error_in_get_terminals_and_productions = true;
-									std::cout << (is_alpha(term_info[1][0]) ? 
-												// is alphabet
-												"\nCaughtException: Invalid non-integer argument to precedence field: '" : 
-												// not-alphabet
-												"\nError: Terminal associativity field can only be one of : 'r' (right - associative), 'l' (left - associative), 'n' (non - associative)\n")
-											<< term_info[1] << "'\n"
-											<< "[Line " << l_no << "]: " << line << "\n";
-									continue;
-								}
-							}
-							catch (std::out_of_range const& ex) {
-								error_in_get_terminals_and_productions = true;
-								std::cout << "\nCaughtException: Argument to precedence field exceeds integer range: '" << term_info[1] << "'\n"
-									<< "[Line " << l_no << "]: " << line << "\n";
-								continue;
-							}
+				// Test if lhs or rhs can come up empty.
+				auto rhs = line.substr(j + 3);
+				auto rhs_column = j + 4;
+				if (rhs.empty()) {
+					error(rhs_column, "Error: Grammar production rhs is empty. Ill-defined grammar.");
+					continue;
+				}
 
-							terminals.emplace(*strings.find(term_info[0]), prec, associativity);
-						}
-						else if (term_info.size() == 3) {
-							if (term_info[2] != "n" && term_info[2] != "l" && term_info[2] != "r") {
-								error_in_get_terminals_and_productions = true;
-								std::cout << "\nError: Terminal associativity field can only be one of: 'r' (right-associative), 'l' (left-associative), 'n' (non-associative)\n"
-									<< "[Line " << l_no << "]: " << line << "\n";
-							}
+				// check for explicitly defined precedence for rule/production
+				int prec = 0;
+				for (auto i = rhs.size() - 1; i > 0; i--) {
+					if (!is_whitespace(rhs[i])) continue;
 
-							strings.insert(term_info[0]);
-							
-							int prec = 0;
-							try {
-								prec = std::stoi(term_info[1]);
-							}
-							catch (std::invalid_argument const& ex) {
-								error_in_get_terminals_and_productions = true;
-								std::cout << "\nCaughtException: Invalid non-integer argument to precedence field: '" << term_info[1] << "'\n"
-									<< "[Line " << l_no << "]: " << line << "\n";
-								continue;
-							}
-							catch (std::out_of_range const& ex) {
-								error_in_get_terminals_and_productions = true;
-								std::cout << "\nCaughtException: Argument to precedence field exceeds integer range: '" << term_info[1] << "'\n"
-									<< "[Line " << l_no << "]: " << line << "\n";
-								continue;
-							}
-							
-							terminals.emplace(*strings.find(term_info[0]), prec, term_info[2]);
-						}
-						else {
-							error_in_get_terminals_and_productions = true;
-							std::cout << "\nError: Terminal symbol declaration information should not contain more than three fields\n"
-								<< "[Line " << l_no << "]: " << line << "\n";
-							continue;
-						}
+					auto symbol = rhs.substr(i + 1);
+					if (symbol.empty()) continue;
 
-						if (l_no == 1) goal_production_lookahead_symbol = *strings.find(term_info[0]);
-					}
-					else if (line == "") {
-						parsing_terminals = false;
-						if (!error_in_get_terminals_and_productions) parsing_productions = true;
-					}
-					else {
-						error_in_get_terminals_and_productions = true;
-						std::cout << "\nError: Terminal symbols must be declared with a 't_' prefix.\n"
-							<< "[Line " << l_no++ << "]: " << line << "\n";
+					auto parsed = parse_integer(symbol, prec);
+					// final symbol is not a precedence value
+					if (parsed == IntegerField::INVALID) break;
+					// final symbol is a precedence value but is beyond the integer range
+					if (parsed == IntegerField::OUT_OF_RANGE) {
+						error(rhs_column + i + 1, "CaughtException: Argument to precedence field exceeds integer range: '" + std::string(symbol) + "'");
+						break;
 					}
+
+					// final is a precedence value
+					rhs = rhs.substr(0, i);
+					break;
 				}
-				else if (parsing_productions) {
-					if (line[0] == 't' && line[1] == '_') {
-						error_in_get_terminals_and_productions = true;
-						std::cout << "\nError: Terminal symbols ('t_' prefix) cannot be on the LHS of a production rule\n"
-							<< "[Line " << l_no++ << "]: " << line << "\n";
-						continue;
+
+				if (error_in_get_terminals_and_productions) continue;
+
+				productions[lhs].push_back(rhs);
+				production_precedence[rhs] = prec;
+			}
+		}
+
+		if (!error_in_get_terminals_and_productions) build_production_table();
+
+		if (debug && !error_in_get_terminals_and_productions) {
+			print_debug_info(TERMINALS);
+			print_debug_info(NON_TERMINALS);
+			print_debug_info(PRODUCTIONS);
+		}
+
+		return !error_in_get_terminals_and_productions;
+	}
+
+	// Split every production into symbol ids, once, into the production table that the later phases index
+	// into. Symbols are numbered in declaration order, followed by any symbol used without being declared
+	// (reported by check_symbols_in_productions); productions by LHS in declaration order. simplify_grammar
+	// rebuilds the table after rewriting 'productions'.
+	void build_production_table() {
+		symbol_table.clear();
+		symbol_ids.clear();
+		production_symbols.clear();
+		production_offsets.assign(1, 0);
+		production_precedences.clear();
+		production_rhs.clear();
+
+		auto symbol_id = [this](std::string_view name) {
+			auto inserted = symbol_ids.emplace(name, static_cast<uint32_t>(symbol_table.size()));
+			if (inserted.second) {
+				bool terminal = is_terminal(name);
+				symbol_table.push_back({ name, terminal, terminal || non_terminals.count(name), {}, {} });
+			}
+			return inserted.first->second;
+		};
+		symbol_ids.reserve(declared_symbols.size());
+		symbol_table.reserve(declared_symbols.size());
+		for (auto symbol : declared_symbols) symbol_id(symbol);
+
+		for (auto lhs : declared_symbols) {
+			auto production = productions.find(lhs);
+			if (production == productions.end()) continue;
+
+			for (auto rhs : production->second) {
+				auto index = static_cast<uint32_t>(production_rhs.size());
+				production_symbols.push_back(symbol_id(lhs));
+				size_t start = 0;
+				for (size_t i = 0; i <= rhs.size(); i++) {
+					if (i == rhs.size() || is_whitespace(rhs[i])) {
+						if (i > start) production_symbols.push_back(symbol_id(rhs.substr(start, i - start)));
+						start = i + 1;
 					}
-					else if (line == "") {
-						l_no++;
-						continue;
+				}
+				production_offsets.push_back(static_cast<uint32_t>(production_symbols.size()));
+				production_precedences.push_back(production_precedence[rhs]);
+				production_rhs.push_back(rhs);
+
+				// 'firsts' of the LHS: the leftmost terminal of the RHS, if any
+				auto& lhs_symbol = symbol_table[production_begin(index)[0]];
+				lhs_symbol.productions.push_back(index);
+				for (uint32_t i = 1; i < production_size(index); i++) {
+					auto symbol = production_begin(index)[i];
+					if (!symbol_table[symbol].terminal) continue;
+					if (std::find(lhs_symbol.firsts.begin(), lhs_symbol.firsts.end(), symbol) == lhs_symbol.firsts.end()) {
+						lhs_symbol.firsts.push_back(symbol);
 					}
+					break;
+				}
+			}
+		}
+	}
 
-					size_t start = 0;
-					size_t j = 0;
+	bool check_symbols_in_productions() {
+		bool found_invalid_symbol = false;
 
-					while (!is_whitespace(line[j])) { j++; }
+		// RHS -> the first production with that RHS
+		std::map<std::vector<uint32_t>, uint32_t> valid_prod;
+
+		for (uint32_t p = 0; p < production_rhs.size(); p++) {
+			auto production = production_begin(p);
+			auto production_end = production + production_size(p);
+			auto lhs = symbol_table[production[0]].name;
+			for (auto symbol = production + 1; symbol < production_end; symbol++) {
+				if (!symbol_table[*symbol].declared) {
+					found_invalid_symbol = true;
+					std::cout << "\nError: Unexpected symbol '" << symbol_table[*symbol].name << "'\n"
+						<< "Fix production rule: '" << lhs << " > " << production_rhs[p] << "'\n";
+				}
+			}
 
-					// valid lhs of production has been scanned
-					std::string lhs = std::string(line, start, j);
-					strings.insert(lhs);
-					if (productions.size() == 0) goal_lhs_symbol = *strings.find(lhs);
-					non_terminals.emplace(*strings.find(lhs));
+			auto first = valid_prod.emplace(std::vector<uint32_t>(production + 1, production_end), p);
+			if (!first.second) {
+				std::string symbols_in_rhs;
+				for (auto symbol = production + 1; symbol < production_end; symbol++) {
+					if (symbol > production + 1) symbols_in_rhs += " ";
+					symbols_in_rhs += symbol_table[*symbol].name;
+				}
+				std::cout << "\nError: Ill-defined grammar has REDUCE-REDUCE conflict.\n"
+					<< lhs << " > " << symbols_in_rhs << " AND "
+					<< symbol_table[production_begin(first.first->second)[0]].name << " > " << symbols_in_rhs << "\n";
+				return false;
+			}
+		}
 
-					start = j;  j += 3;
-					std::string delim = std::string(line, start, j - start);
+		return !found_invalid_symbol;
+	}
 
-					if (delim != " > ") {
-						error_in_get_terminals_and_productions = true;
-						std::cout << "\nError: Expected ' > ' delimiter between LHS and RHS of production rule\n"
-							<< "[Line " << l_no++ << "]: " << line << "\n";
-						continue;
+	// Grammar simplification, run before the canonical collection is built:
+	//  - removes unproductive non-terminals (those that can never derive a string of terminals),
+	//    and the productions that use them,
+	//  - removes non-terminals that cannot be reached from the goal production,
+	//  - inlines a non-terminal B into the single production that uses it, if B has a single production
+	//    of its own. For example, 'A > t_X B' and 'B > t_Y C' become 'A > t_X t_Y C'.
+	// The goal and 'preserved_symbols' are never inlined, so their reductions stay visible to the parse
+	// function. Neither are rules with an explicit precedence, or rules that would change the last terminal
+	// (and so the precedence) of the production they're inlined into. Returns false if the goal production
+	// is unproductive.
+	bool simplify_grammar() {
+		// unproductive non-terminals
+		std::unordered_set<std::string_view> productive;
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			for (auto& production : productions) {
+				if (productive.count(production.first)) continue;
+				for (auto& rhs : production.second) {
+					bool all_productive = true;
+					for (auto symbol : split_rhs(rhs)) {
+						if (!is_terminal(symbol) && !productive.count(symbol)) {
+							all_productive = false;
+							break;
+						}
 					}
+					if (all_productive) {
+						productive.insert(production.first);
+						changed = true;
+						break;
+					}
+				}
+			}
+		}
 
-					auto symbol_start = start = j;
-					bool found_first = false;
-					// Check for leftmost terminal in rhs of production
-					for (; j < line.size(); j++) {
-						if (is_whitespace(line[j])) {
-							if (!found_first && terminals.count(Terminal(std::string(line, symbol_start, j - symbol_start), 0, "n"))) {
-								found_first = true;
-								firsts[*strings.find(lhs)].insert(*strings.find(std::string(line, symbol_start, j - symbol_start)));
-							}
-							symbol_start = j + 1;
-						}
+		if (!productive.count(goal_lhs_symbol)) {
+			std::cout << "\nError: Goal production '" << goal_lhs_symbol << "' cannot derive any string of terminals.\n";
+			return false;
+		}
 
-						if (found_first) break;
-					}
+		for (auto it = productions.begin(); it != productions.end();) {
+			if (!productive.count(it->first)) {
+				simplification_report.push_back("removed unproductive non-terminal '" + std::string(it->first) + "'");
+				non_terminals.erase(it->first);
+				it = productions.erase(it);
+				continue;
+			}
+
+			auto& rhs_list = it->second;
+			for (auto rhs = rhs_list.begin(); rhs != rhs_list.end();) {
+				bool uses_unproductive = false;
+				for (auto symbol : split_rhs(*rhs)) {
+					if (!is_terminal(symbol) && !productive.count(symbol)) uses_unproductive = true;
+				}
+				if (uses_unproductive) {
+					simplification_report.push_back("removed production '" + std::string(it->first) + " > " + std::string(*rhs) + "'");
+					rhs = rhs_list.erase(rhs);
+				}
+				else {
+					++rhs;
+				}
+			}
+			++it;
+		}
 
-					// if 'found_first' is still false, check if rightmost rhs symbol is a terminal
-					if (!found_first && terminals.count(Terminal(std::string(line, symbol_start, j - symbol_start), 0, "n"))) {
-						found_first = true;
-						firsts[*strings.find(lhs)].insert(*strings.find(std::string(line, symbol_start, j - symbol_start)));
+		// unreachable non-terminals
+		std::unordered_set<std::string_view> reachable{ goal_lhs_symbol };
+		std::vector<std::string_view> worklist{ goal_lhs_symbol };
+		while (!worklist.empty()) {
+			auto lhs = worklist.back();
+			worklist.pop_back();
+			for (auto& rhs : productions[lhs]) {
+				for (auto symbol : split_rhs(rhs)) {
+					if (!is_terminal(symbol) && !reachable.count(symbol)) {
+						reachable.insert(symbol);
+						worklist.push_back(symbol);
 					}
+				}
+			}
+		}
 
-					// Test if lhs or rhs can come up empty.
-					std::string rhs(line, start, line.size() - start);
+		for (auto it = productions.begin(); it != productions.end();) {
+			if (!reachable.count(it->first)) {
+				simplification_report.push_back("removed unreachable non-terminal '" + std::string(it->first) + "'");
+				non_terminals.erase(it->first);
+				it = productions.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
 
-					if (rhs == "") {
-						error_in_get_terminals_and_productions = true;
-						std::cout << "\nError: Grammar production rhs is empty. Ill-defined grammar.\n"
-							<< "[Line " << l_no << "]: " << line << "\n";
-						continue;
+		// single-use, single-production non-terminals
+		changed = true;
+		while (changed) {
+			changed = false;
+
+			// non-terminal -> number of occurrences in all RHS
+			std::unordered_map<std::string_view, size_t> uses;
+			std::unordered_set<std::string> all_rhs;
+			for (auto& production : productions) {
+				for (auto& rhs : production.second) {
+					all_rhs.insert(std::string(rhs));
+					for (auto symbol : split_rhs(rhs)) {
+						if (!is_terminal(symbol)) ++uses[symbol];
 					}
-					
-					// check for explicitly defined precedence for rule/production
-					int prec = 0;
-					for (auto i = static_cast<int>(rhs.size()); i > 0; i--) {
-						if (is_whitespace(rhs[i])) {
-							std::string symbol = std::string(rhs, i + 1, rhs.size() - i);
-							if (symbol == "") continue;
+				}
+			}
 
-							try {
-								prec = std::stoi(symbol);
-							}
-							catch (std::invalid_argument const& ex) {
-								// final symbol is not a precedence value
-								break;
-							}
-							catch (std::out_of_range const& ex) {
-								// final symbol is a precedence value but is beyond the integer range
-								error_in_get_terminals_and_productions = true;
-								std::cout << "\nCaughtException: Argument to precedence field exceeds integer range: '" << symbol << "'\n"
-									<< "[Line " << l_no << "]: " << line << "\n";
-								break;
-							}
+			for (auto& production : productions) {
+				auto inlined = production.first;
+				if (inlined == goal_lhs_symbol || preserved_symbols.count(std::string(inlined)) ||
+					production.second.size() != 1 || uses[inlined] != 1 ||
+					production_precedence[production.second[0]] != 0)
+				{
+					continue;
+				}
 
-							// final is a precedence value
-							rhs = std::string(rhs, 0, i);
-							break;
-						}
+				auto inlined_rhs = split_rhs(production.second[0]);
+				bool inlinable = true;
+				for (auto symbol : inlined_rhs) {
+					// recursive, or takes part in precedence-driven conflict resolution
+					if (symbol == inlined ||
+						(is_terminal(symbol) && (terminals.find(Terminal(symbol, 0, "n"))->precedence != 0 ||
+												 terminals.find(Terminal(symbol, 0, "n"))->associativity != "n")))
+					{
+						inlinable = false;
 					}
+				}
+				if (!inlinable) continue;
+
+				// find the single production using 'inlined'
+				for (auto& host : productions) {
+					for (auto& host_rhs : host.second) {
+						auto host_symbols = split_rhs(host_rhs);
+						auto position = std::find(host_symbols.begin(), host_symbols.end(), inlined);
+						if (position == host_symbols.end()) continue;
+
+						std::vector<std::string_view> new_symbols(host_symbols.begin(), position);
+						new_symbols.insert(new_symbols.end(), inlined_rhs.begin(), inlined_rhs.end());
+						new_symbols.insert(new_symbols.end(), position + 1, host_symbols.end());
+
+						std::string new_rhs;
+						for (auto symbol : new_symbols) {
+							if (!new_rhs.empty()) new_rhs += " ";
+							new_rhs += symbol;
+						}
 
-					if (error_in_get_terminals_and_productions) continue;
+						// the inlined production must not change the precedence of the production using it,
+						// nor duplicate an existing RHS (a REDUCE-REDUCE conflict)
+						if (last_terminal_precedence(new_symbols) != last_terminal_precedence(host_symbols) ||
+							all_rhs.count(new_rhs)) break;
 
-					strings.insert(rhs);
-					strings.insert(lhs);
+						simplification_report.push_back("inlined '" + std::string(inlined) + " > " + std::string(production.second[0]) +
+							"' into '" + std::string(host.first) + " > " + std::string(host_rhs) + "'");
 
-					productions[*strings.find(lhs)].push_back(*strings.find(rhs));
-					production_precedence[*strings.find(rhs)] = prec;
+						strings.insert(new_rhs);
+						auto interned_rhs = std::string_view(*strings.find(new_rhs));
+						production_precedence[interned_rhs] = production_precedence[host_rhs];
+						host_rhs = interned_rhs;
+
+						non_terminals.erase(inlined);
+						productions.erase(inlined);
+						changed = true;
+						break;
+					}
+					if (changed) break;
 				}
-				l_no++;
+				// 'productions' has been modified, so start over with fresh use counts
+				if (changed) break;
 			}
 		}
 
-		if (debug && !error_in_get_terminals_and_productions) {
-			print_debug_info(TERMINALS);
+		for (auto& terminal : terminals) {
+			bool used = terminal.str == goal_production_lookahead_symbol;
+			for (auto& production : productions) {
+				for (auto& rhs : production.second) {
+					for (auto symbol : split_rhs(rhs)) {
+						if (symbol == terminal.str) used = true;
+					}
+				}
+			}
+			if (!used) simplification_report.push_back("note: terminal '" + std::string(terminal.str) + "' is never used (kept in TokenType)");
+		}
+
+		build_production_table();
+		if (debug) {
 			print_debug_info(NON_TERMINALS);
 			print_debug_info(PRODUCTIONS);
 		}
+		return true;
+	}
 
-		return !error_in_get_terminals_and_productions;
+	// Read per-production weights for generate_sentences: one production per line, preceded by its
+	// weight, e.g. '4 Expression > Add'. Productions not listed weigh 1.
+	bool read_production_weights(const std::string& weights_path) {
+		std::ifstream file(weights_path, std::ios::in);
+		if (!file.is_open()) return false;
+
+		std::string line;
+		size_t l_no = 0;
+		while (std::getline(file, line)) {
+			++l_no;
+			std::stringstream fields(line);
+			double weight;
+			std::string lhs, arrow, symbol;
+			if (!(fields >> weight)) continue; // blank lines and comments
+			if (!(fields >> lhs >> arrow) || arrow != ">" || weight < 0) {
+				sentence_report.push_back("line " + std::to_string(l_no) + " of the weights: expected '<weight> <LHS> > <RHS>', skipped");
+				continue;
+			}
+			std::vector<std::string> rhs_symbols;
+			while (fields >> symbol) rhs_symbols.push_back(symbol);
+
+			// the RHS as written in the grammar, whatever the spacing
+			bool found = false;
+			auto production = productions.find(lhs);
+			if (production != productions.end()) {
+				for (auto rhs : production->second) {
+					auto symbols = split_rhs(rhs);
+					if (std::equal(symbols.begin(), symbols.end(), rhs_symbols.begin(), rhs_symbols.end())) {
+						production_weights[std::make_pair(production->first, rhs)] = weight;
+						found = true;
+						break;
+					}
+				}
+			}
+			if (!found) sentence_report.push_back("line " + std::to_string(l_no) + " of the weights: no such production, skipped");
+		}
+		return true;
 	}
 
-	bool check_symbols_in_productions() {
-		bool found_invalid_symbol = false;
-		bool reduce_reduce_conflict = false;
-		
-		std::unordered_map<std::string, std::string> valid_prod;
+	// Write 'count' random sentences of the grammar to 'sentences_path', one per line, as whitespace
+	// separated terminals (the corpus format read by apply_profile). Each sentence is derived from the
+	// goal, expanding the leftmost non-terminal by a production picked at random in proportion to its
+	// weight, among those that still allow the derivation to end within 'sentence_max_depth' nested
+	// expansions and, if bounded, the sentence's length budget. That budget is drawn uniformly from
+	// [sentence_min_length, sentence_max_length] for every sentence; sentences that come out shorter
+	// than the minimum are drawn again a few times.
+	bool generate_sentences(size_t count, const std::string& sentences_path) {
+		constexpr size_t unreachable = static_cast<size_t>(-1) / 4;
+
+		// symbols by dense index, so the generation loop does no hash lookups
+		struct Alternative {
+			std::vector<size_t> symbols;
+			double weight;
+			size_t min_height = unreachable; // nested expansions needed to derive only terminals
+			size_t min_length = unreachable; // fewest terminals derivable
+		};
+		struct Symbol {
+			std::string_view name;
+			bool terminal;
+			size_t min_height;
+			size_t min_length;
+			std::vector<Alternative> alternatives;
+		};
+		std::vector<Symbol> symbols;
+		std::unordered_map<std::string_view, size_t> symbol_index;
+		auto index_of = [&](std::string_view name) {
+			auto inserted = symbol_index.emplace(name, symbols.size());
+			if (inserted.second) {
+				bool terminal = is_terminal(name);
+				symbols.push_back({ name, terminal, terminal ? 0 : unreachable, terminal ? 1 : unreachable, {} });
+			}
+			return inserted.first->second;
+		};
+		for (uint32_t p = 0; p < production_rhs.size(); p++) {
+			auto production = production_begin(p);
+			auto lhs = index_of(symbol_table[production[0]].name);
+			Alternative alternative;
+			for (uint32_t i = 1; i < production_size(p); i++) alternative.symbols.push_back(index_of(symbol_table[production[i]].name));
+			auto weight = production_weights.find(std::make_pair(symbol_table[production[0]].name, production_rhs[p]));
+			alternative.weight = weight == production_weights.end() ? 1.0 : weight->second;
+			symbols[lhs].alternatives.push_back(std::move(alternative));
+		}
 
-		std::string symbol;
+		// fixpoint: non-terminals that never derive a string of terminals keep 'unreachable'
+		for (bool changed = true; changed;) {
+			changed = false;
+			for (auto& symbol : symbols) {
+				for (auto& alternative : symbol.alternatives) {
+					size_t height = 0, length = 0;
+					for (auto child : alternative.symbols) {
+						height = std::max(height, symbols[child].min_height);
+						length = std::min(unreachable, length + symbols[child].min_length);
+					}
+					alternative.min_height = std::min(unreachable, height + 1);
+					alternative.min_length = length;
+					if (alternative.min_height < symbol.min_height) {
+						symbol.min_height = alternative.min_height;
+						changed = true;
+					}
+					if (alternative.min_length < symbol.min_length) {
+						symbol.min_length = alternative.min_length;
+						changed = true;
+					}
+				}
+			}
+		}
 
-		for (auto& production : productions) {
-			std::vector<std::string_view> values = production.second;
-			for (auto& value : values) {
-				std::string symbols_in_rhs;
-				auto start = 0; auto i = 0;
-				for (auto i = 0; i < value.size(); i++) {
-					if (is_whitespace(value[i])) {
-						symbol = std::string(value, start, i - start);
-						if (symbol != "") {
-							if (!(terminals.count(Terminal(symbol, 0, "n")) || 
-								non_terminals.count(symbol)))
-							{
-								found_invalid_symbol = true;
-								std::cout << "\nError: Unexpected symbol '" << symbol << "'\n"
-									<< "Fix production rule: '" << production.first << " > " << value << "'\n";
-							}
-							symbols_in_rhs += symbol;
-							symbols_in_rhs += " ";
+		auto& goal = symbols[index_of(goal_lhs_symbol)];
+		if (goal.min_height >= unreachable) {
+			sentence_report.push_back("the goal '" + std::string(goal_lhs_symbol) + "' derives no string of terminals");
+			return false;
+		}
+		auto max_depth = sentence_max_depth;
+		if (max_depth < goal.min_height) {
+			max_depth = goal.min_height;
+			sentence_report.push_back("the shortest derivations are " + std::to_string(max_depth) + " expansions deep, depth raised to match");
+		}
+
+		std::vector<char> file_buffer(1 << 20);
+		std::ofstream file;
+		file.rdbuf()->pubsetbuf(file_buffer.data(), file_buffer.size());
+		file.open(sentences_path, std::ios::out | std::ios::binary);
+		if (!file.is_open()) return false;
+
+		std::mt19937_64 random(sentence_seed);
+		struct Pending {
+			size_t symbol;
+			size_t depth;
+		};
+		std::vector<Pending> stack;
+		std::vector<const Alternative*> candidates;
+		std::string sentence;
+		std::string out;
+		size_t terminals_written = 0, shortest = unreachable, longest = 0, deepest = 0, below_minimum = 0;
+		auto goal_index = index_of(goal_lhs_symbol);
+
+		for (size_t n = 0; n < count; n++) {
+			for (size_t attempt = 0; attempt < 16; attempt++) {
+				size_t budget = unreachable;
+				if (sentence_max_length) {
+					budget = std::uniform_int_distribution<size_t>(std::min(sentence_min_length, sentence_max_length), sentence_max_length)(random);
+				}
+
+				sentence.clear();
+				size_t length = 0;
+				size_t pending_length = goal.min_length; // fewest terminals the stack can still derive
+				stack.assign(1, { goal_index, 0 });
+				while (!stack.empty()) {
+					auto pending = stack.back();
+					stack.pop_back();
+					auto& symbol = symbols[pending.symbol];
+					if (symbol.terminal) {
+						if (length) sentence += ' ';
+						sentence += symbol.name;
+						++length;
+						--pending_length;
+						continue;
+					}
+					deepest = std::max(deepest, pending.depth + 1);
+
+					// alternatives that fit the depth and length budgets; if none fits both, the depth
+					// budget wins (it always fits), and among those, the shortest
+					auto base_length = length + pending_length - symbol.min_length;
+					candidates.clear();
+					double total_weight = 0;
+					for (auto& alternative : symbol.alternatives) {
+						if (pending.depth + alternative.min_height <= max_depth && base_length + alternative.min_length <= budget) {
+							candidates.push_back(&alternative);
+							total_weight += alternative.weight;
 						}
-						start = i + 1;
 					}
-				}
+					if (candidates.empty() || total_weight <= 0) {
+						candidates.clear();
+						const Alternative* shortest_fit = nullptr;
+						for (auto& alternative : symbol.alternatives) {
+							if (pending.depth + alternative.min_height > max_depth) continue;
+							if (!shortest_fit || alternative.min_length < shortest_fit->min_length) shortest_fit = &alternative;
+						}
+						candidates.push_back(shortest_fit);
+						total_weight = 0;
+					}
 
-				symbol = std::string(value, start, value.size() - start);
-				if (symbol != "") {
-					if (!(terminals.count(Terminal(symbol, 0, "n")) ||
-						non_terminals.count(symbol)))
-					{
-						found_invalid_symbol = true;
-						std::cout << "\nError: Unexpected symbol '" << symbol << "'\n"
-							<< "Fix production rule: '" << production.first << " > " << value << "'\n";
+					auto chosen = candidates.front();
+					if (total_weight > 0) {
+						auto pick = std::uniform_real_distribution<double>(0, total_weight)(random);
+						for (auto candidate : candidates) {
+							chosen = candidate;
+							pick -= candidate->weight;
+							if (pick < 0) break;
+						}
+					}
+
+					pending_length = pending_length - symbol.min_length + chosen->min_length;
+					for (auto child = chosen->symbols.rbegin(); child != chosen->symbols.rend(); ++child) {
+						stack.push_back({ *child, pending.depth + 1 });
 					}
-					symbols_in_rhs += symbol;
 				}
 
-				if (!valid_prod.count(symbols_in_rhs)) valid_prod[symbols_in_rhs] = production.first;
-				else {
-					reduce_reduce_conflict = true;
-					std::cout << "\nError: Ill-defined grammar has REDUCE-REDUCE conflict.\n"
-						<< production.first << " > " << symbols_in_rhs << " AND "
-						<< valid_prod[symbols_in_rhs] << " > " << symbols_in_rhs << "\n";
-					return !reduce_reduce_conflict;
+				if (length >= sentence_min_length || attempt == 15) {
+					below_minimum += length < sentence_min_length;
+					shortest = std::min(shortest, length);
+					longest = std::max(longest, length);
+					terminals_written += length;
+					break;
 				}
 			}
-		}
 
-		return !found_invalid_symbol;
+			out += sentence;
+			out += '\n';
+			if (out.size() >= (1 << 16)) {
+				file.write(out.data(), out.size());
+				out.clear();
+			}
+		}
+		file.write(out.data(), out.size());
+		file.close();
+
+		sentence_report.push_back(std::to_string(count) + " sentences written to '" + sentences_path + "', " +
+			std::to_string(terminals_written) + " terminals (" + std::to_string(count ? shortest : 0) + " to " +
+			std::to_string(longest) + " per sentence), up to " + std::to_string(deepest) + " expansions deep");
+		if (below_minimum) {
+			sentence_report.push_back(std::to_string(below_minimum) + " sentences are shorter than the minimum length");
+		}
+		return !file.fail();
 	}
 
 	void build_cc() {
-		std::unordered_set<Item, CustomHash> canonicalSet_0;
-		auto& goal = productions[goal_lhs_symbol];
-		for (auto& prod : goal) {
-			std::vector<std::string_view> beginItemProd;
-			std::string symbol;
-			auto start = 0;
-			auto i = 0;
-			beginItemProd.push_back(goal_lhs_symbol);
-			for (; i < prod.size(); i++) {
-				if (is_whitespace(prod[i])) {
-					symbol = std::string(prod, start, i - start);
-					if (symbol != "") {
-						beginItemProd.push_back(*strings.find(symbol));
-					}
-					start = i + 1;
-				}
+		production_reduce_rules.assign(production_rhs.size(), no_reduce_rule);
+
+		ItemSet canonicalSet_0{ &collection_arena };
+		auto goal = symbol_ids.find(goal_lhs_symbol);
+		auto lookahead = symbol_ids.find(goal_production_lookahead_symbol);
+		if (goal != symbol_ids.end() && lookahead != symbol_ids.end()) {
+			for (auto index : symbol_table[goal->second].productions) {
+				canonicalSet_0.emplace(1, index, lookahead->second);
 			}
-			
-			symbol = std::string(prod, start, i - start);
-			if (symbol != "") beginItemProd.push_back(*strings.find(symbol));
-			
-			canonicalSet_0.emplace(1, beginItemProd, goal_production_lookahead_symbol, production_precedence[prod]);
 		}
 		
-		closure_function(canonicalSet_0);
-		CanonicalCollectionValue ccv{ set_index, false };
-		canonicalCollection[canonicalSet_0] = ccv;
-
-		auto number_of_unmarked_sets = 0;
+		if (!kernel_states) closure_function(canonicalSet_0);
 		size_t set_index = 0;
-		// count "unmarked" and keep looping until "unmarked" is equal
-		// to zero. That is, all available sets in canonicalCollection have
-		// been processed. This is to ensure that sets inserted after the
-		// current iterator position get visited in subsequent passes.
-
-		++number_of_unmarked_sets;
-		while (number_of_unmarked_sets > 0) {
-			for (auto& canonicalSet_i : canonicalCollection) {
-				if (canonicalSet_i.second.marked == false) {
-					canonicalSet_i.second.marked = true;
-					for (auto& item : canonicalSet_i.first) {
-						std::unordered_set<Item, CustomHash> new_set;
-						if (item.position >= item.production.size()) continue;
-						goto_function(canonicalSet_i.first, item.production[item.position], new_set);
-
-						if (!canonicalCollection.count(new_set)) {
-							++set_index;
-							ccv = { set_index, false };
-							canonicalCollection[new_set] = ccv;
-							++number_of_unmarked_sets;
-						}
-					}
-				}
-				else {
-					--number_of_unmarked_sets;
+		canonicalCollection.emplace(std::move(canonicalSet_0), CanonicalCollectionValue{ set_index, false });
+
+		// Unmarked sets, in the order they were added. Every set is processed exactly once: iterating
+		// canonicalCollection itself while inserting into it could end the loop with sets left unmarked
+		// (their transitions missing from the tables), depending on where the new sets landed.
+		std::vector<decltype(canonicalCollection)::value_type*> unmarked_sets{ &*canonicalCollection.begin() };
+		for (size_t next = 0; next < unmarked_sets.size(); next++) {
+			auto& canonicalSet_i = *unmarked_sets[next];
+			canonicalSet_i.second.marked = true;
+			auto& items = closed_items(canonicalSet_i.first, canonicalSet_i.second.state);
+			for (auto& item : items) {
+				if (item.position >= production_size(item.production)) continue;
+				ItemSet new_set{ &scratch_pool };
+				goto_function(items, symbol_after_dot(item), new_set);
+				++stats.candidate_sets;
+
+				// a new set is copied into collection_arena
+				auto inserted = canonicalCollection.try_emplace(new_set, CanonicalCollectionValue{ set_index + 1, false });
+				if (inserted.second) {
+					++set_index;
+					unmarked_sets.push_back(&*inserted.first);
 				}
 			}
 		}
 
+		scratch_pool.release();
 		if (debug) print_debug_info(CANONICAL_SET);
 	}
 
 	void build_tables() {
 		for (auto& canonicalSet_i : canonicalCollection) {
 			auto current_state = canonicalSet_i.second.state;
-
-			for (auto& item : canonicalSet_i.first) {
-				if (item.position < item.production.size() &&
-					terminals.count(Terminal(item.production[item.position], 0, "n"))) 
-				{
-					std::string_view terminal = item.production[item.position];
+			auto& items = closed_items(canonicalSet_i.first, canonicalSet_i.second.state);
+
+			for (auto& item : items) {
+				auto production = production_begin(item.production);
+				auto production_length = production_size(item.production);
+				auto precedence = production_precedences[item.production];
+				auto lookahead = symbol_table[item.lookahead].name;
+				if (item.position < production_length && symbol_table[production[item.position]].terminal) {
+					std::string_view terminal = symbol_table[production[item.position]].name;
 					// check for SHIFT-REDUCE conflict
 					if (!actionTable.count(std::make_pair(current_state, terminal))) {
-						std::unordered_set<Item, CustomHash> next_set;
-						goto_function(canonicalSet_i.first, terminal, next_set);
+						ItemSet next_set{ &scratch_pool };
+						goto_function(items, production[item.position], next_set);
 
 						if (canonicalCollection.count(next_set)) {
 							auto next_state = canonicalCollection[next_set].state;
@@ -718,11 +1892,9 @@ public:
 						// SHIFT-REDUCE Conflict
 						int last_terminal_precedence = 0;
 						std::string last_terminal_associativity = "n";
-						std::string_view item_production_lhs = item.production[0];
-
-						set_last_terminal(last_terminal_precedence, last_terminal_associativity, item.production);
+						set_last_terminal(last_terminal_precedence, last_terminal_associativity, production_names(item.production));
 
-						if (item.production_precedence > terminals.find(Terminal(terminal, 0, "n"))->precedence ||
+						if (precedence > terminals.find(Terminal(terminal, 0, "n"))->precedence ||
 							last_terminal_precedence == 0)
 						{
 							// valid REDUCE, do nothing
@@ -737,8 +1909,8 @@ public:
 						}
 						else {
 							// invalid REDUCE, use SHIFT instead.
-							std::unordered_set<Item, CustomHash> next_set;
-							goto_function(canonicalSet_i.first, terminal, next_set);
+							ItemSet next_set{ &scratch_pool };
+							goto_function(items, production[item.position], next_set);
 
 							if (canonicalCollection.count(next_set)) {
 								auto next_state = canonicalCollection[next_set].state;
@@ -748,48 +1920,47 @@ public:
 						}
 					}
 				}
-				else if (item.position == item.production.size()) {
-					if (item.production[0] == goal_lhs_symbol &&
-						item.lookahead == goal_production_lookahead_symbol) 
+				else if (item.position == production_length) {
+					if (symbol_table[production[0]].name == goal_lhs_symbol &&
+						lookahead == goal_production_lookahead_symbol) 
 					{
 						Action action{ ACCEPT, 0 };
 						actionTable[std::make_pair(current_state, goal_production_lookahead_symbol)] = action;
 					}
 					else {
-						std::string_view item_production_lhs = item.production[0];
 						// Check for SHIFT-REDUCE conflict
 						int last_terminal_precedence = 0;
 						std::string last_terminal_associativity = "n";
-						set_last_terminal(last_terminal_precedence, last_terminal_associativity, item.production);
+						set_last_terminal(last_terminal_precedence, last_terminal_associativity, production_names(item.production));
 
 						// Note that these seperate conditions can be combined to a single if-or statement.
 						// Regardless, I choose to retain it this way because the conditions are long
 						// and ugly. This preserves readability, somewhat.
 
-						if (item.production_precedence > terminals.find(Terminal(item.lookahead, 0, "n"))->precedence ||
+						if (precedence > terminals.find(Terminal(lookahead, 0, "n"))->precedence ||
 							last_terminal_precedence == 0)
 						{
-							Action action{ REDUCE, reduce_info_map.find(std::make_pair(item_production_lhs, item.production.size() - 1))->second };
-							actionTable[std::make_pair(current_state, item.lookahead)] = action;
+							Action action{ REDUCE, production_reduce_rules[item.production] };
+							actionTable[std::make_pair(current_state, lookahead)] = action;
 						}
-						else if (last_terminal_precedence > terminals.find(Terminal(item.lookahead, 0, "n"))->precedence) {
-							Action action{ REDUCE, reduce_info_map.find(std::make_pair(item_production_lhs, item.production.size() - 1))->second };
-							actionTable[std::make_pair(current_state, item.lookahead)] = action;
+						else if (last_terminal_precedence > terminals.find(Terminal(lookahead, 0, "n"))->precedence) {
+							Action action{ REDUCE, production_reduce_rules[item.production] };
+							actionTable[std::make_pair(current_state, lookahead)] = action;
 						}
-						else if (last_terminal_precedence == terminals.find(Terminal(item.lookahead, 0, "n"))->precedence &&
+						else if (last_terminal_precedence == terminals.find(Terminal(lookahead, 0, "n"))->precedence &&
 							last_terminal_associativity == "l")
 						{
-							Action action{ REDUCE, reduce_info_map.find(std::make_pair(item_production_lhs, item.production.size() - 1))->second };
-							actionTable[std::make_pair(current_state, item.lookahead)] = action;
+							Action action{ REDUCE, production_reduce_rules[item.production] };
+							actionTable[std::make_pair(current_state, lookahead)] = action;
 						}
 						else {
-							std::unordered_set<Item, CustomHash> next_set;
-							goto_function(canonicalSet_i.first, item.lookahead, next_set);
+							ItemSet next_set{ &scratch_pool };
+							goto_function(items, item.lookahead, next_set);
 
 							if (canonicalCollection.count(next_set)) {
 								auto next_state = canonicalCollection[next_set].state;
 								Action action{ SHIFT, next_state };
-								actionTable[std::make_pair(current_state, item.lookahead)] = action;
+								actionTable[std::make_pair(current_state, lookahead)] = action;
 							}
 						}
 					}
@@ -797,8 +1968,8 @@ public:
 			}
 
 			for (auto& non_term : non_terminals) {
-				std::unordered_set<Item, CustomHash> next_set;
-				goto_function(canonicalSet_i.first, non_term, next_set);
+				ItemSet next_set{ &scratch_pool };
+				goto_function(items, symbol_ids[non_term], next_set);
 				if (canonicalCollection.count(next_set)) {
 					auto next_state = canonicalCollection[next_set].state;
 					gotoTable[std::make_pair(current_state, non_term)] = next_state;
@@ -806,12 +1977,286 @@ public:
 			}
 		}
 
+		release_closed_states();
+		scratch_pool.release();
+
+		if (eliminate_chain_productions) eliminate_chain_rules();
+		if (use_default_reductions) build_default_reductions();
+		number_canonically();
+
 		if (debug) {
 			print_debug_info(ACTION_TABLE);
 			print_debug_info(GOTO_TABLE);
 		}
 	}
 
+	// Profile-guided state and symbol numbering.
+	// Each line of the corpus is a sentence of whitespace-separated terminals (lines starting with '#' are
+	// ignored); the goal production lookahead terminal is appended if missing. Every sentence is parsed with
+	// the generated tables, counting how often each state is consulted and each symbol is shifted or reduced
+	// to. States are then renumbered by descending frequency (state 0 stays the start state) and terminals
+	// ordered likewise in TokenType, so the rows and entries taken most often come first in the output file.
+	// Returns false if the corpus file cannot be opened.
+	bool apply_profile(const std::string& profile_path) {
+		std::ifstream file(profile_path, std::ios::in);
+		if (!file.is_open()) return false;
+
+		auto state_count = canonicalCollection.size();
+		std::vector<size_t> state_visits(state_count, 0);
+		std::unordered_map<std::string_view, size_t> symbol_counts;
+		size_t steps = 0;
+
+		std::string first_line;
+		std::getline(file, first_line);
+		if (first_line == PARSEGEN_PROFILE_CSV_HEADER) {
+			read_counter_profile(file, state_visits, symbol_counts, steps);
+		}
+		else {
+			file.clear();
+			file.seekg(0);
+			read_profile_corpus(file, state_visits, symbol_counts, steps);
+		}
+
+		// state 0 is where every parse starts, so it keeps its number
+		std::vector<size_t> order(state_count);
+		for (size_t state = 0; state < state_count; state++) order[state] = state;
+		std::stable_sort(order.begin() + 1, order.end(), [&](size_t a, size_t b) {
+			return state_visits[a] > state_visits[b];
+		});
+
+		std::vector<size_t> new_state(state_count);
+		for (size_t position = 0; position < state_count; position++) new_state[order[position]] = position;
+		renumber_states(new_state);
+
+		auto symbols = token_type_order();
+		for (auto non_term : non_terminal_order()) symbols.push_back(non_term);
+		std::stable_sort(symbols.begin(), symbols.end(), [&](std::string_view a, std::string_view b) {
+			return symbol_counts[a] > symbol_counts[b];
+		});
+
+		terminal_order.clear();
+		symbol_rank.clear();
+		for (size_t rank = 0; rank < symbols.size(); rank++) {
+			auto symbol = symbols[rank];
+			symbol_rank[symbol] = rank;
+			if (is_terminal(symbol)) terminal_order.push_back(symbol);
+		}
+		profiled = true;
+
+		// share of all table lookups served by the hottest tenth of the states
+		size_t hot_states = std::max<size_t>(1, state_count / 10);
+		size_t hot_steps = 0;
+		for (size_t position = 0; position < hot_states; position++) hot_steps += state_visits[order[position]];
+
+		profile_report.push_back("hottest " + std::to_string(hot_states) + " of " + std::to_string(state_count) + " states take " +
+			std::to_string(steps ? hot_steps * 100 / steps : 0) + "% of the parse steps");
+		return true;
+	}
+
+	// Key of the generated output in the generation cache: a 64-bit FNV-1a hash of the generator
+	// version (PARSEGEN_OUTPUT_VERSION and PARSEGEN_SOURCE_HASH), the options affecting the output
+	// ('options'), and the grammar text. The text is only normalized where the grammar reader ignores
+	// differences: blank lines between productions, and line breaks at the end of the file. Anything
+	// else, declaration order included, can change the generated tables, and so changes the key.
+	std::string cache_key(const std::string& options) {
+		std::string normalized;
+		bool in_productions = false;
+		size_t start = 0;
+		while (start < grammar_text.size()) {
+			auto end = grammar_text.find('\n', start);
+			if (end == std::string_view::npos) end = grammar_text.size();
+			auto line = grammar_text.substr(start, end - start);
+			start = end + 1;
+
+			if (line.empty()) {
+				if (in_productions) continue;
+				in_productions = true;
+			}
+			normalized.append(line);
+			normalized += '\n';
+		}
+		while (!normalized.empty() && normalized.back() == '\n') normalized.pop_back();
+
+		uint64_t hash = 14695981039346656037ull;
+		auto add = [&hash](std::string_view text) {
+			for (unsigned char c : text) hash = (hash ^ c) * 1099511628211ull;
+			hash = (hash ^ 0xff) * 1099511628211ull; // separator
+		};
+		add("parsegen " PARSEGEN_OUTPUT_VERSION " " PARSEGEN_SOURCE_HASH);
+		add(options);
+		add(normalized);
+
+		std::stringstream key;
+		key << std::hex << std::setw(16) << std::setfill('0') << hash;
+		return key.str();
+	}
+
+	// A cache entry holds every output file (the header, and the data file with --split), each as its
+	// size in decimal on a line of its own followed by its contents.
+	// On a cache hit, write the cached output to 'output_file_path' and mark the entry as recently used
+	bool restore_from_cache(const std::string& cache_dir, const std::string& key, bool binary) {
+		namespace fs = std::filesystem;
+		auto entry = fs::path(cache_dir) / (key + ".out");
+		std::ifstream cached(entry, std::ios::in | std::ios::binary);
+		std::vector<std::string> contents(split_output ? 2 : 1);
+		for (auto& content : contents) {
+			size_t size = 0;
+			std::string size_line;
+			if (!std::getline(cached, size_line) || size_line.empty() ||
+				size_line.find_first_not_of("0123456789") != std::string::npos)
+			{
+				cached.setstate(std::ios::failbit);
+				break;
+			}
+			size = std::strtoull(size_line.c_str(), nullptr, 10);
+			content.resize(size);
+			cached.read(content.data(), static_cast<std::streamsize>(size));
+		}
+		if (!cached) {
+			cache_report.push_back("miss (" + key + ")");
+			return false;
+		}
+
+		std::ofstream file(output_file_path, std::ios::out | std::ios::binary);
+		if (!file.is_open()) {
+			file_access_error = true;
+			output_file_path = binary ? "output.bin" : "output.h";
+			file.open(output_file_path, std::ios::out | std::ios::binary);
+		}
+		file << contents[0];
+		if (split_output) {
+			data_file_path = split_data_path();
+			std::ofstream data(data_file_path, std::ios::out | std::ios::binary);
+			data << contents[1];
+		}
+
+		std::error_code error;
+		fs::last_write_time(entry, fs::file_time_type::clock::now(), error);
+		cache_report.push_back("hit (" + key + "), build_cc and build_tables skipped");
+		return true;
+	}
+
+	// Copy the output just written into the cache, then evict least recently used entries until the
+	// cache holds at most 'limit_bytes'
+	void store_in_cache(const std::string& cache_dir, const std::string& key, uintmax_t limit_bytes) {
+		namespace fs = std::filesystem;
+		std::error_code error;
+		fs::create_directories(cache_dir, error);
+
+		// written under a temporary name and renamed, so a concurrent run never restores a partial entry
+		auto entry = fs::path(cache_dir) / (key + ".out");
+		auto temporary = fs::path(cache_dir) / (key + ".tmp");
+		{
+			std::ofstream cached(temporary, std::ios::out | std::ios::binary);
+			for (auto& path : { output_file_path, data_file_path }) {
+				if (path.empty()) continue;
+				std::ifstream output(path, std::ios::in | std::ios::binary);
+				std::stringstream content;
+				content << output.rdbuf();
+				cached << content.str().size() << "\n" << content.str();
+			}
+			if (!cached) {
+				cache_report.push_back("unable to store the output in " + cache_dir);
+				return;
+			}
+		}
+		fs::rename(temporary, entry, error);
+		if (error) {
+			fs::remove(temporary, error);
+			cache_report.push_back("unable to store the output in " + cache_dir);
+			return;
+		}
+
+		std::vector<std::pair<fs::file_time_type, fs::path>> entries;
+		uintmax_t total = 0;
+		for (auto& file : fs::directory_iterator(cache_dir, error)) {
+			if (file.path().extension() != ".out") continue;
+			auto size = file.file_size(error);
+			if (error) continue;
+			total += size;
+			entries.emplace_back(file.last_write_time(error), file.path());
+		}
+		std::sort(entries.begin(), entries.end());
+
+		size_t evicted = 0;
+		for (auto& [time, path] : entries) {
+			if (total <= limit_bytes || path == entry) continue;
+			auto size = fs::file_size(path, error);
+			if (!error && fs::remove(path, error)) {
+				total -= size;
+				++evicted;
+			}
+		}
+		cache_report.push_back("stored (" + key + "), cache holds " + std::to_string(entries.size() - evicted) + " entries, " +
+			std::to_string(total / 1024) + " KiB" + (evicted ? ", " + std::to_string(evicted) + " evicted" : ""));
+	}
+
+	void write_token_type_enum(std::ostream& file) {
+		size_t col = 0;
+		auto total = terminals.size();
+		file << "enum TokenType {\n\t";
+		for (auto& term : token_type_order()) {
+			file << term;
+			++col;
+			if (col == total) file << "\n};\n\n";
+			else if (!(col % 8)) file << ",\n\t";
+			else if (col < total) file << ", ";
+		}
+	}
+
+	// The narrowest unsigned type holding 'max_value'
+	static const char* narrowest_type(size_t max_value) {
+		if (max_value <= 0xff) return "uint8_t";
+		if (max_value <= 0xffff) return "uint16_t";
+		if (max_value <= 0xffffffff) return "uint32_t";
+		return "uint64_t";
+	}
+
+	// Types of the generated table entries, the narrowest that fit this grammar: states (actionTable and
+	// gotoTable keys, gotoTable values), rules (default_reductions, with NO_DEFAULT_REDUCTION as the
+	// largest value), and the word an Action packs its ActionType (2 bits) and value (the rest) into
+	struct EntryTypes {
+		const char* state;
+		const char* rule;
+		const char* action_word;
+		unsigned action_value_bits;
+	};
+
+	EntryTypes entry_types() {
+		auto states = canonicalCollection.size();
+		auto rules = reduce_info.size();
+		auto max_value = std::max<size_t>({ states ? states - 1 : 0, rules ? rules - 1 : 0, 1 });
+		unsigned value_bits = 0;
+		while (max_value >> value_bits) ++value_bits;
+
+		unsigned word_bits = 8;
+		while (word_bits < 64 && value_bits + 2 > word_bits) word_bits *= 2;
+		return { narrowest_type(states ? states - 1 : 0), narrowest_type(rules), narrowest_type(size_t(1) << (word_bits - 1)), word_bits - 2 };
+	}
+
+	// PairHash for hashing the keys of the actionTable and gotoTable unordered_maps, the ActionType enum and the Action struct
+	void write_action_types(std::ostream& file) {
+		auto types = entry_types();
+		file << "struct PairHash {\n"
+			"\tsize_t operator()(const std::pair<" << types.state << ", std::string_view>& pair) const {\n"
+			"\t\treturn std::hash<size_t>{}(pair.first) ^ std::hash<std::string_view>{}(pair.second);\n"
+			"\t}\n\n"
+			"\tsize_t operator()(const std::pair<" << types.state << ", TokenType>& pair) const {\n"
+			"\t\treturn std::hash<size_t>{}(pair.first) ^ pair.second;\n"
+			"\t}\n"
+			"};\n\n"
+			"enum ActionType : " << types.action_word << " {\n"
+			"\tSHIFT,\n"
+			"\tREDUCE,\n"
+			<< (use_default_reductions ? "\tACCEPT,\n\tSHIFT_REDUCE\n" : "\tACCEPT\n") <<
+			"};\n\n"
+			"// One " << types.action_word << ": the ActionType, and the next state or index into reduce_info\n"
+			"struct Action {\n"
+			"\tActionType type : 2;\n"
+			"\t" << types.action_word << " value : " << types.action_value_bits << ";\n"
+			"};\n\n";
+	}
+
 	void build_output_file() {
 		std::ofstream file(output_file_path, std::ios::out);
 		
@@ -822,6 +2267,7 @@ public:
 		}
 		
 		file << "#pragma once\n\n"
+			"#include <cstdint>\n"
 			"#include <unordered_map>\n"
 			"#include <unordered_set>\n"
 			"#include <string>\n"
@@ -831,7 +2277,7 @@ public:
 			"std::unordered_set<std::string> strings {\n\t";
 		auto col = 0;
 		auto total = non_terminals.size();
-		for (auto& non_term : non_terminals) {
+		for (auto& non_term : non_terminal_order()) {
 			file << "\"" << non_term << "\"";
 			++col;
 			if (col == total) file << "\n};\n\n";
@@ -840,18 +2286,7 @@ public:
 		}
 		// end define strings cache
 
-		// start define terminals enum
-		col = 0;
-		total = terminals.size();
-		file << "enum TokenType {\n\t";
-		for (auto& term : terminals) {
-			file << term.str;
-			++col;
-			if (col == total) file << "\n};\n\n";
-			else if (!(col % 8)) file << ",\n\t";
-			else if (col < total) file << ", ";
-		}
-		// end define terminals enum
+		write_token_type_enum(file);
 
 		// start define reduce_info vector
 		col = 0;
@@ -866,34 +2301,15 @@ public:
 		}
 		// end define reduce_info vector
 
-		// start define PairHash for hashing the key to the actionTable unordered_map, and gotoTable unordered_map
-		file << "struct PairHash {\n"
-			"\tsize_t operator()(const std::pair<size_t, std::string_view>& pair) const {\n"
-			"\t\treturn std::hash<size_t>{}(pair.first) ^ std::hash<std::string_view>{}(pair.second);\n"
-			"\t}\n\n"
-			"\tsize_t operator()(const std::pair<size_t, TokenType>& pair) const {\n"
-			"\t\treturn std::hash<size_t>{}(pair.first) ^ pair.second;\n"
-			"\t}\n"
-			"};\n\n";
-		// end define PairHash
-
-		// start define ActionType enum, and Action struct
-		file << "enum ActionType {\n"
-			"\tSHIFT,\n"
-			"\tREDUCE,\n"
-			"\tACCEPT\n"
-			"};\n\n"
-			"struct Action {\n"
-			"\tActionType type;\n"
-			"\tsize_t value;\n"
-			"};\n\n"
-			// end define ActionType enum, and Action struct
+		write_action_types(file);
+		auto types = entry_types();
 
-			// start actionTable definition
-			"std::unordered_map<std::pair<size_t, TokenType>, Action, PairHash> actionTable {\n\t";
+		// start actionTable definition
+		file << "std::unordered_map<std::pair<" << types.state << ", TokenType>, Action, PairHash> actionTable {\n\t";
 		col = 0;
 		total = actionTable.size();
-		for (auto& entry : actionTable) {
+		for (auto entry_ptr : emission_order(actionTable)) {
+			auto& entry = *entry_ptr;
 			file << "{{ " << entry.first.first << ", " << entry.first.second << " }, {";
 			switch (entry.second.type) {
 			case SHIFT:
@@ -905,6 +2321,9 @@ public:
 			case ACCEPT:
 				file << "ACCEPT, ";
 				break;
+			case SHIFT_REDUCE:
+				file << "SHIFT_REDUCE, ";
+				break;
 			}
 			file << entry.second.value << " }";
 			++col;
@@ -915,10 +2334,11 @@ public:
 		// end actionTable definition
 
 		// start gotoTable definition
-		file << "std::unordered_map<std::pair<size_t, std::string_view>, size_t, PairHash> gotoTable {\n\t";
+		file << "std::unordered_map<std::pair<" << types.state << ", std::string_view>, " << types.state << ", PairHash> gotoTable {\n\t";
 		col = 0;
 		total = gotoTable.size();
-		for (auto& entry : gotoTable) {
+		for (auto entry_ptr : emission_order(gotoTable)) {
+			auto& entry = *entry_ptr;
 			file << "{{ " << entry.first.first << ", *strings.find(\"" << entry.first.second << "\") }, {" << entry.second << "}";
 			++col;
 			if (col == total) file << "}\n};";
@@ -926,11 +2346,769 @@ public:
 			else if (col < total) file << "}, ";
 		}
 		// end gotoTabe definition
+
+		// start default_reductions definition
+		if (use_default_reductions) {
+			file << "\n\nconstexpr " << types.rule << " NO_DEFAULT_REDUCTION = static_cast<" << types.rule << ">(-1);\n\n"
+				"// index: state, value: index into reduce_info to REDUCE by without consulting actionTable\n"
+				"std::vector<" << types.rule << "> default_reductions {\n\t";
+			total = canonicalCollection.size();
+			for (size_t state = 0; state < total; state++) {
+				auto found = default_reductions.find(state);
+				if (found != default_reductions.end()) file << found->second;
+				else file << "NO_DEFAULT_REDUCTION";
+
+				if (state + 1 == total) file << "\n};";
+				else if (!((state + 1) % 4)) file << ",\n\t";
+				else file << ", ";
+			}
+		}
+		// end default_reductions definition
+	}
+
+	// 'output_file_path' with a .cpp extension
+	std::string split_data_path() {
+		auto dot = output_file_path.find_last_of('.');
+		auto slash = output_file_path.find_last_of("/\\");
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return output_file_path + ".cpp";
+		return output_file_path.substr(0, dot) + ".cpp";
+	}
+
+	// --split: a header with the declarations of the tables, and a translation unit defining them. The
+	// header keeps the names and types of build_output_file, so parse functions work with either. The
+	// data is written as flat arrays of integers, which compile quickly at any size, and loaded into
+	// the tables when the program starts.
+	void build_split_output_files() {
+		std::ofstream file(output_file_path, std::ios::out);
+		if (!file.is_open()) {
+			file_access_error = true;
+			output_file_path = "output.h";
+			file.open(output_file_path, std::ios::out);
+		}
+		data_file_path = split_data_path();
+		std::ofstream data(data_file_path, std::ios::out);
+
+		file << "#pragma once\n\n"
+			"#include <cstdint>\n"
+			"#include <unordered_map>\n"
+			"#include <unordered_set>\n"
+			"#include <string>\n"
+			"#include <string_view>\n"
+			"#include <vector>\n\n"
+			"// Parse tables, defined in " << std::filesystem::path(data_file_path).filename().string() << "\n\n"
+			"extern std::unordered_set<std::string> strings;\n\n";
+		write_token_type_enum(file);
+		file << "extern std::vector<std::pair<std::string_view, size_t>> reduce_info;\n\n";
+		write_action_types(file);
+		auto types = entry_types();
+		std::string action_map = std::string("std::unordered_map<std::pair<") + types.state + ", TokenType>, Action, PairHash>";
+		std::string goto_map = std::string("std::unordered_map<std::pair<") + types.state + ", std::string_view>, " + types.state + ", PairHash>";
+		file << "extern " << action_map << " actionTable;\n"
+			"extern " << goto_map << " gotoTable;\n\n";
+		if (use_default_reductions) {
+			file << "constexpr " << types.rule << " NO_DEFAULT_REDUCTION = static_cast<" << types.rule << ">(-1);\n\n"
+				"// index: state, value: index into reduce_info to REDUCE by without consulting actionTable\n"
+				"extern std::vector<" << types.rule << "> default_reductions;\n\n";
+		}
+		file << "// Lookups into actionTable and gotoTable. False if there is no entry.\n"
+			"bool find_action(size_t state, TokenType token, Action& action);\n"
+			"bool find_goto(size_t state, std::string_view non_terminal, size_t& next_state);\n";
+
+		auto names = non_terminal_order();
+		std::unordered_map<std::string_view, size_t> name_index;
+		for (auto& name : names) name_index[name] = name_index.size();
+		auto token_types = token_type_order();
+		std::unordered_map<std::string_view, size_t> token_index;
+		for (auto& term : token_types) token_index[term] = token_index.size();
+
+		// 'values' as the elements of a flat array of the narrowest type that holds them, 'per_line' at a
+		// time. An empty array gets a placeholder element, since arrays cannot be empty.
+		auto write_array = [&data](const char* name, const std::vector<size_t>& values, size_t per_line) {
+			size_t max_value = 0;
+			for (auto value : values) max_value = std::max(max_value, value);
+			data << "const " << narrowest_type(max_value) << " " << name << "[] = {\n\t";
+			if (values.empty()) data << "0";
+			for (size_t i = 0; i < values.size(); i++) {
+				data << values[i];
+				if (i + 1 == values.size()) break;
+				data << ((i + 1) % per_line ? ", " : ",\n\t");
+			}
+			data << "\n};\n\n";
+		};
+
+		data << "#include \"" << std::filesystem::path(output_file_path).filename().string() << "\"\n\n"
+			"#include <iterator>\n\n"
+			"namespace {\n\n"
+			"const char* const non_terminal_names[] = {\n\t";
+		for (size_t i = 0; i < names.size(); i++) {
+			data << "\"" << names[i] << "\"" << (i + 1 == names.size() ? "\n};\n\n" : (i + 1) % 8 ? ", " : ",\n\t");
+		}
+
+		std::vector<size_t> values;
+		for (auto& info : reduce_info) {
+			values.push_back(name_index[info.first]);
+			values.push_back(info.second);
+		}
+		data << "// { LHS (index into non_terminal_names), pop count } per rule\n"
+			"constexpr size_t rule_count = " << reduce_info.size() << ";\n";
+		write_array("rules", values, 16);
+
+		values.clear();
+		for (auto entry_ptr : emission_order(actionTable)) {
+			values.push_back(entry_ptr->first.first);
+			values.push_back(token_index[entry_ptr->first.second]);
+			values.push_back(entry_ptr->second.type);
+			values.push_back(entry_ptr->second.value);
+		}
+		data << "// { state, TokenType, ActionType, value } per actionTable entry\n"
+			"constexpr size_t action_count = " << actionTable.size() << ";\n";
+		write_array("actions", values, 16);
+
+		values.clear();
+		for (auto entry_ptr : emission_order(gotoTable)) {
+			values.push_back(entry_ptr->first.first);
+			values.push_back(name_index[entry_ptr->first.second]);
+			values.push_back(entry_ptr->second);
+		}
+		data << "// { state, non-terminal (index into non_terminal_names), next state } per gotoTable entry\n"
+			"constexpr size_t goto_count = " << gotoTable.size() << ";\n";
+		write_array("gotos", values, 15);
+
+		if (use_default_reductions) {
+			values.clear();
+			for (size_t state = 0; state < canonicalCollection.size(); state++) {
+				auto found = default_reductions.find(state);
+				values.push_back(found != default_reductions.end() ? found->second : reduce_info.size());
+			}
+			data << "// index: state, value: index into reduce_info, or rule_count for none\n";
+			write_array("default_reduction_rules", values, 8);
+		}
+
+		data << "} // namespace\n\n"
+			"std::unordered_set<std::string> strings(std::begin(non_terminal_names), std::end(non_terminal_names));\n\n"
+			"std::vector<std::pair<std::string_view, size_t>> reduce_info = [] {\n"
+			"\tstd::vector<std::pair<std::string_view, size_t>> info;\n"
+			"\tinfo.reserve(rule_count);\n"
+			"\tfor (size_t i = 0; i < rule_count; i++) {\n"
+			"\t\tinfo.emplace_back(*strings.find(non_terminal_names[rules[2 * i]]), rules[2 * i + 1]);\n"
+			"\t}\n"
+			"\treturn info;\n"
+			"}();\n\n"
+			<< action_map << " actionTable = [] {\n"
+			"\t" << action_map << " table(action_count);\n"
+			"\tfor (size_t i = 0; i < action_count; i++) {\n"
+			"\t\tauto entry = actions + 4 * i;\n"
+			"\t\ttable.emplace(std::make_pair(static_cast<" << types.state << ">(entry[0]), static_cast<TokenType>(entry[1])),\n"
+			"\t\t\tAction{ static_cast<ActionType>(entry[2]), static_cast<" << types.action_word << ">(entry[3]) });\n"
+			"\t}\n"
+			"\treturn table;\n"
+			"}();\n\n"
+			<< goto_map << " gotoTable = [] {\n"
+			"\t" << goto_map << " table(goto_count);\n"
+			"\tfor (size_t i = 0; i < goto_count; i++) {\n"
+			"\t\tauto entry = gotos + 3 * i;\n"
+			"\t\ttable.emplace(std::make_pair(static_cast<" << types.state << ">(entry[0]), std::string_view(*strings.find(non_terminal_names[entry[1]]))),\n"
+			"\t\t\tstatic_cast<" << types.state << ">(entry[2]));\n"
+			"\t}\n"
+			"\treturn table;\n"
+			"}();\n\n";
+		if (use_default_reductions) {
+			data << "std::vector<" << types.rule << "> default_reductions = [] {\n"
+				"\tstd::vector<" << types.rule << "> reductions;\n"
+				"\tfor (auto rule : default_reduction_rules) reductions.push_back(rule == rule_count ? NO_DEFAULT_REDUCTION : static_cast<" << types.rule << ">(rule));\n"
+				"\treturn reductions;\n"
+				"}();\n\n";
+		}
+		data << "bool find_action(size_t state, TokenType token, Action& action) {\n"
+			"\tauto entry = actionTable.find(std::make_pair(static_cast<" << types.state << ">(state), token));\n"
+			"\tif (entry == actionTable.end()) return false;\n"
+			"\taction = entry->second;\n"
+			"\treturn true;\n"
+			"}\n\n"
+			"bool find_goto(size_t state, std::string_view non_terminal, size_t& next_state) {\n"
+			"\tauto entry = gotoTable.find(std::make_pair(static_cast<" << types.state << ">(state), non_terminal));\n"
+			"\tif (entry == gotoTable.end()) return false;\n"
+			"\tnext_state = entry->second;\n"
+			"\treturn true;\n"
+			"}\n";
+	}
+
+	// --emit-code: the automaton as code instead of tables. direct_parse() has a block of code per state,
+	// which pushes the state and switches on the next token, and a block per non-terminal, which switches
+	// on the state below a reduction's RHS to find where to go next (the goto table). SHIFT, REDUCE and
+	// goto entries become jumps between the blocks, and every state switches on its own, so the compiler
+	// can lay out and predict each one separately. reduce_info is the same as in build_output_file.
+	void build_code_output_file() {
+		std::ofstream file(output_file_path, std::ios::out);
+		if (!file.is_open()) {
+			file_access_error = true;
+			output_file_path = "output.h";
+			file.open(output_file_path, std::ios::out);
+		}
+
+		file << "#pragma once\n\n"
+			"#include <cstddef>\n"
+			"#include <string_view>\n"
+			"#include <utility>\n"
+			"#include <vector>\n\n";
+
+		write_token_type_enum(file);
+
+		size_t col = 0;
+		auto total = reduce_info.size();
+		file << "std::vector<std::pair<std::string_view, size_t>> reduce_info {\n\t";
+		for (auto& info : reduce_info) {
+			file << "{ \"" << info.first << "\", " << info.second << " }";
+			++col;
+			if (col == total) file << "\n};\n\n";
+			else if (!(col % 2)) file << ",\n\t";
+			else if (col < total) file << ", ";
+		}
+
+		auto state_count = canonicalCollection.size();
+		std::vector<std::vector<const decltype(actionTable)::value_type*>> action_rows(state_count);
+		for (auto entry : emission_order(actionTable)) action_rows[entry->first.first].push_back(entry);
+		std::unordered_map<std::string_view, std::vector<const decltype(gotoTable)::value_type*>> goto_columns;
+		for (auto entry : emission_order(gotoTable)) goto_columns[entry->first.second].push_back(entry);
+
+		// only the labels something jumps to are written
+		std::vector<bool> state_targeted(state_count, false);
+		std::vector<bool> reduced(reduce_info.size(), false), shift_reduced(reduce_info.size(), false);
+		for (auto& entry : actionTable) {
+			if (entry.second.type == SHIFT) state_targeted[entry.second.value] = true;
+			else if (entry.second.type == REDUCE) reduced[entry.second.value] = true;
+			else if (entry.second.type == SHIFT_REDUCE) shift_reduced[entry.second.value] = true;
+		}
+		for (auto& entry : default_reductions) reduced[entry.second] = true;
+		for (auto& entry : gotoTable) state_targeted[entry.second] = true;
+		std::vector<std::string_view> goto_symbols;
+		for (auto& non_term : non_terminal_order()) {
+			for (size_t rule = 0; rule < reduce_info.size(); rule++) {
+				if (reduce_info[rule].first == non_term && (reduced[rule] || shift_reduced[rule])) {
+					goto_symbols.push_back(non_term);
+					break;
+				}
+			}
+		}
+		auto goto_label = [&goto_symbols](std::string_view non_term) {
+			return "goto_" + std::to_string(std::find(goto_symbols.begin(), goto_symbols.end(), non_term) - goto_symbols.begin());
+		};
+
+		file << "// Parse 'tokens' (TokenType values, ending with " << goal_production_lookahead_symbol << "), with 'states' as the state stack.\n"
+			"// on_shift(position) is called for every token shifted, on_reduce(index into reduce_info) after every\n"
+			"// reduction. Returns false on a syntax error.\n"
+			"template<typename Symbol, typename OnShift, typename OnReduce>\n"
+			"bool direct_parse(const Symbol* tokens, size_t count, std::vector<size_t>& states, OnShift&& on_shift, OnReduce&& on_reduce) {\n"
+			"\tstates.clear();\n"
+			"\tsize_t i = 0;\n";
+
+		for (size_t state = 0; state < state_count; state++) {
+			file << "\n";
+			if (state_targeted[state]) file << "state_" << state << ":\n";
+			file << "\tstates.push_back(" << state << ");\n";
+
+			auto default_reduction = default_reductions.find(state);
+			if (default_reduction != default_reductions.end()) {
+				file << "\tgoto reduce_" << default_reduction->second << ";\n";
+				continue;
+			}
+
+			file << "\tif (i == count) return false;\n"
+				"\tswitch (tokens[i]) {\n";
+			for (auto entry : action_rows[state]) {
+				file << "\tcase " << entry->first.second << ": ";
+				switch (entry->second.type) {
+				case SHIFT:
+					file << "on_shift(i); ++i; goto state_" << entry->second.value << ";\n";
+					break;
+				case REDUCE:
+					file << "goto reduce_" << entry->second.value << ";\n";
+					break;
+				case ACCEPT:
+					file << "return true;\n";
+					break;
+				case SHIFT_REDUCE:
+					file << "on_shift(i); ++i; goto shift_reduce_" << entry->second.value << ";\n";
+					break;
+				}
+			}
+			file << "\tdefault: return false;\n"
+				"\t}\n";
+		}
+
+		// a SHIFT_REDUCE never pushes the state it shifts to, so there is one state less to pop
+		auto write_reduction = [&](const char* label, size_t rule, size_t pop_count) {
+			file << "\n" << label << rule << ":\n";
+			if (pop_count) file << "\tstates.resize(states.size() - " << pop_count << ");\n";
+			file << "\ton_reduce(" << rule << ");\n"
+				"\tgoto " << goto_label(reduce_info[rule].first) << ";\n";
+		};
+		for (size_t rule = 0; rule < reduce_info.size(); rule++) {
+			if (shift_reduced[rule]) write_reduction("shift_reduce_", rule, reduce_info[rule].second - 1);
+			if (reduced[rule]) write_reduction("reduce_", rule, reduce_info[rule].second);
+		}
+
+		for (auto non_term : goto_symbols) {
+			file << "\n" << goto_label(non_term) << ": // " << non_term << "\n"
+				"\tswitch (states.back()) {\n";
+			for (auto entry : goto_columns[non_term]) {
+				file << "\tcase " << entry->first.first << ": goto state_" << entry->second << ";\n";
+			}
+			file << "\tdefault: return false;\n"
+				"\t}\n";
+		}
+		file << "}\n";
+	}
+
+	// --emit-recognizer: a parser that only answers whether the input is in the language, and where it
+	// stopped if not. The tables are flat arrays of the narrowest types (no hash maps, no reduce_info
+	// strings), and a reduction goes from the state it uncovers and its rule straight to the next state
+	// through a composite reduce/goto table, without looking up its LHS. Default reductions are spread
+	// over every column of their state's row, which keeps the row lookup the only branch per token.
+	void build_recognizer_output_file() {
+		std::ofstream file(output_file_path, std::ios::out);
+		if (!file.is_open()) {
+			file_access_error = true;
+			output_file_path = "output.h";
+			file.open(output_file_path, std::ios::out);
+		}
+
+		auto types = entry_types();
+		auto state_count = canonicalCollection.size();
+		auto rule_count = reduce_info.size();
+		auto token_types = token_type_order();
+		std::unordered_map<std::string_view, size_t> token_index;
+		for (auto& term : token_types) token_index[term] = token_index.size();
+		auto terminal_count = token_types.size();
+
+		// action word: the kind in the top 2 bits, the next state or rule below; 0 is a syntax error
+		// and 1 (kind 0) is ACCEPT
+		enum : size_t { error_entry = 0, accept_entry = 1, shift_kind = 1, reduce_kind = 2, shift_reduce_kind = 3 };
+		auto pack = [&types](size_t kind, size_t value) { return (kind << types.action_value_bits) | value; };
+		std::vector<size_t> actions(state_count * terminal_count, error_entry);
+		for (auto& entry : actionTable) {
+			auto& slot = actions[entry.first.first * terminal_count + token_index[entry.first.second]];
+			switch (entry.second.type) {
+			case SHIFT: slot = pack(shift_kind, entry.second.value); break;
+			case REDUCE: slot = pack(reduce_kind, entry.second.value); break;
+			case ACCEPT: slot = accept_entry; break;
+			case SHIFT_REDUCE: slot = pack(shift_reduce_kind, entry.second.value); break;
+			}
+		}
+		for (auto& entry : default_reductions) {
+			for (size_t terminal = 0; terminal < terminal_count; terminal++) {
+				actions[entry.first * terminal_count + terminal] = pack(reduce_kind, entry.second);
+			}
+		}
+
+		std::unordered_map<std::string_view, std::vector<size_t>> rules_of;
+		size_t max_pop_count = 0;
+		for (size_t rule = 0; rule < rule_count; rule++) {
+			rules_of[reduce_info[rule].first].push_back(rule);
+			max_pop_count = std::max(max_pop_count, reduce_info[rule].second);
+		}
+		std::vector<size_t> reduce_gotos(state_count * rule_count, state_count);
+		for (auto& entry : gotoTable) {
+			for (auto rule : rules_of[entry.first.second]) reduce_gotos[entry.first.first * rule_count + rule] = entry.second;
+		}
+
+		auto write_array = [&file](const char* type, const char* name, const std::vector<size_t>& values, size_t per_line) {
+			file << "constexpr " << type << " " << name << "[] = {\n\t";
+			if (values.empty()) file << "0";
+			for (size_t i = 0; i < values.size(); i++) {
+				file << values[i];
+				if (i + 1 == values.size()) break;
+				file << ((i + 1) % per_line ? ", " : ",\n\t");
+			}
+			file << "\n};\n\n";
+		};
+
+		file << "#pragma once\n\n"
+			"#include <cstddef>\n"
+			"#include <cstdint>\n"
+			"#include <vector>\n\n";
+		write_token_type_enum(file);
+
+		file << "constexpr size_t terminal_count = " << terminal_count << ";\n"
+			"constexpr size_t rule_count = " << rule_count << ";\n\n"
+			"// Action words: the kind in the top 2 bits, the next state (SHIFT) or rule (REDUCE, SHIFT_REDUCE) below.\n"
+			"// A 0 word is a syntax error, and a 1 word is ACCEPT.\n"
+			"constexpr " << types.action_word << " ACTION_ERROR = 0;\n"
+			"constexpr " << types.action_word << " ACTION_ACCEPT = 1;\n"
+			"constexpr unsigned ACTION_VALUE_BITS = " << types.action_value_bits << ";\n"
+			"constexpr " << types.action_word << " ACTION_VALUE_MASK = " << ((size_t(1) << types.action_value_bits) - 1) << ";\n"
+			"enum ActionKind { SHIFT = " << shift_kind << ", REDUCE = " << reduce_kind << ", SHIFT_REDUCE = " << shift_reduce_kind << " };\n\n"
+			"// index: state * terminal_count + TokenType\n";
+		write_array(types.action_word, "actions", actions, 16);
+		file << "// index: rule, value: number of states to pop\n";
+		std::vector<size_t> pop_counts;
+		for (auto& info : reduce_info) pop_counts.push_back(info.second);
+		write_array(narrowest_type(max_pop_count), "pop_counts", pop_counts, 16);
+		file << "// index: uncovered state * rule_count + rule, value: the state to push after reducing by rule, or\n"
+			"// NO_GOTO where the rule's LHS has no goto from the state. Tables from parsegen never reduce into those.\n"
+			"constexpr " << narrowest_type(state_count) << " NO_GOTO = " << state_count << ";\n";
+		write_array(narrowest_type(state_count), "reduce_gotos", reduce_gotos, 16);
+
+		file << "using State = " << types.state << ";\n\n"
+			"struct Recognition {\n"
+			"\tbool valid;\n"
+			"\tsize_t error_offset; // index of the token the parse stopped at, when not valid\n"
+			"};\n\n"
+			"// Recognize 'tokens' (TokenType values, ending with the goal lookahead terminal), with 'stack' as\n"
+			"// the state stack. The stack grows as needed and is kept for the next call.\n"
+			"template<typename Symbol>\n"
+			"Recognition recognize(const Symbol* tokens, size_t count, std::vector<State>& stack) {\n"
+			"\tif (stack.size() < 64) stack.resize(64);\n"
+			"\tState* states = stack.data();\n"
+			"\tsize_t top = 0;\n"
+			"\tstates[0] = 0;\n\n"
+			"\tfor (size_t i = 0; i < count;) {\n"
+			"\t\tauto token = static_cast<size_t>(tokens[i]);\n"
+			"\t\tif (token >= terminal_count) return { false, i };\n"
+			"\t\tauto action = actions[states[top] * terminal_count + token];\n"
+			"\t\tsize_t rule = action & ACTION_VALUE_MASK;\n"
+			"\t\tswitch (action >> ACTION_VALUE_BITS) {\n"
+			"\t\tcase SHIFT:\n"
+			"\t\t\t++i;\n"
+			"\t\t\tif (++top == stack.size()) {\n"
+			"\t\t\t\tstack.resize(2 * stack.size());\n"
+			"\t\t\t\tstates = stack.data();\n"
+			"\t\t\t}\n"
+			"\t\t\tstates[top] = static_cast<State>(rule);\n"
+			"\t\t\tcontinue;\n"
+			"\t\tcase REDUCE:\n"
+			"\t\t\ttop -= pop_counts[rule];\n"
+			"\t\t\tbreak;\n"
+			"\t\tcase SHIFT_REDUCE:\n"
+			"\t\t\t// the shifted state is never pushed, so there is one state less to pop\n"
+			"\t\t\t++i;\n"
+			"\t\t\ttop -= pop_counts[rule] - 1;\n"
+			"\t\t\tbreak;\n"
+			"\t\tdefault:\n"
+			"\t\t\treturn { action == ACTION_ACCEPT, i };\n"
+			"\t\t}\n\n"
+			"\t\tauto next = reduce_gotos[states[top] * rule_count + rule];\n"
+			"\t\tif (++top == stack.size()) {\n"
+			"\t\t\tstack.resize(2 * stack.size());\n"
+			"\t\t\tstates = stack.data();\n"
+			"\t\t}\n"
+			"\t\tstates[top] = static_cast<State>(next);\n"
+			"\t}\n"
+			"\treturn { false, count };\n"
+			"}\n";
+	}
+
+	// --emit-binary: the tables in the format of runtime/binary-tables.h instead of a header. Symbols
+	// are numbered like TokenType (terminals) and the 'strings' cache (non-terminals), rules like reduce_info.
+	void build_binary_output_file() {
+		using namespace binary_tables;
+
+		std::ofstream file(output_file_path, std::ios::out | std::ios::binary);
+		if (!file.is_open()) {
+			file_access_error = true;
+			output_file_path = "output.bin";
+			file.open(output_file_path, std::ios::out | std::ios::binary);
+		}
+
+		std::vector<std::string_view> symbols = token_type_order();
+		auto terminal_count = symbols.size();
+		std::unordered_map<std::string_view, uint32_t> symbol_index;
+		for (auto& term : symbols) symbol_index[term] = static_cast<uint32_t>(symbol_index.size());
+		for (auto& non_term : non_terminal_order()) {
+			symbol_index[non_term] = static_cast<uint32_t>(symbols.size() - terminal_count);
+			symbols.push_back(non_term);
+		}
+		auto state_count = canonicalCollection.size();
+
+		std::vector<std::vector<std::pair<uint32_t, uint32_t>>> action_rows(state_count), goto_rows(state_count);
+		for (auto& entry : actionTable) {
+			action_rows[entry.first.first].emplace_back(symbol_index[entry.first.second],
+				static_cast<uint32_t>(entry.second.type) << kind_shift | static_cast<uint32_t>(entry.second.value));
+		}
+		for (auto& entry : gotoTable) {
+			goto_rows[entry.first.first].emplace_back(symbol_index[entry.first.second], static_cast<uint32_t>(entry.second));
+		}
+		for (auto& row : action_rows) std::sort(row.begin(), row.end());
+		for (auto& row : goto_rows) std::sort(row.begin(), row.end());
+
+		std::vector<uint32_t> action_base, action_check, action_value, goto_base, goto_check, goto_value;
+		pack_rows(action_rows, profiled, action_base, action_check, action_value);
+		pack_rows(goto_rows, profiled, goto_base, goto_check, goto_value);
+
+		std::string blob(HEADER_SIZE, '\0');
+		auto set = [&blob](uint32_t offset, size_t value) {
+			auto field = static_cast<uint32_t>(value);
+			std::memcpy(&blob[offset], &field, sizeof(field));
+		};
+		auto append = [&blob](size_t value) {
+			auto field = static_cast<uint32_t>(value);
+			blob.append(reinterpret_cast<const char*>(&field), sizeof(field));
+		};
+		auto append_section = [&](uint32_t header_field, const std::vector<uint32_t>& section) {
+			set(header_field, blob.size());
+			for (auto entry : section) append(entry);
+		};
+
+		// the name bytes go last, so their offsets are known once the fixed-size sections are laid out
+		auto names_size = symbols.size() * 8;
+		auto rules_size = reduce_info.size() * 8;
+		auto name_bytes = HEADER_SIZE + names_size + rules_size + (action_base.size() + action_check.size() + action_value.size() +
+			goto_base.size() + goto_check.size() + goto_value.size() + (use_default_reductions ? state_count : 0)) * 4;
+
+		set(NAMES, blob.size());
+		for (auto& symbol : symbols) {
+			append(name_bytes);
+			append(symbol.size());
+			name_bytes += symbol.size();
+		}
+		set(RULES, blob.size());
+		for (auto& rule : reduce_info) {
+			append(symbol_index[rule.first]);
+			append(rule.second);
+		}
+		append_section(ACTION_BASE, action_base);
+		append_section(ACTION_CHECK, action_check);
+		append_section(ACTION_VALUE, action_value);
+		append_section(GOTO_BASE, goto_base);
+		append_section(GOTO_CHECK, goto_check);
+		append_section(GOTO_VALUE, goto_value);
+		if (use_default_reductions) {
+			set(DEFAULT_REDUCTIONS, blob.size());
+			for (size_t state = 0; state < state_count; state++) {
+				auto found = default_reductions.find(state);
+				append(found != default_reductions.end() ? found->second : none);
+			}
+		}
+		for (auto& symbol : symbols) blob.append(symbol);
+		blob.append((4 - blob.size() % 4) % 4, '\0');
+
+		std::memcpy(&blob[MAGIC], magic, sizeof(magic));
+		set(VERSION, version);
+		set(SIZE, blob.size());
+		set(FLAGS, use_default_reductions ? has_default_reductions : 0);
+		set(STATE_COUNT, state_count);
+		set(TERMINAL_COUNT, terminal_count);
+		set(NON_TERMINAL_COUNT, symbols.size() - terminal_count);
+		set(RULE_COUNT, reduce_info.size());
+		set(ACTION_SLOTS, action_check.size());
+		set(GOTO_SLOTS, goto_check.size());
+		set(CHECKSUM, crc32(reinterpret_cast<const unsigned char*>(blob.data()) + CHECKSUM + 4, blob.size() - CHECKSUM - 4));
+
+		file.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+	}
+
+	// --emit-lazy: the checked grammar in the format of runtime/lazy-tables.h, which builds the tables at
+	// parse time. Symbols are numbered like build_binary_output_file, and rules like reduce_info after
+	// number_canonically (by LHS declaration order, then by pop count).
+	void build_lazy_output_file() {
+		using namespace lazy_tables;
+
+		std::ofstream file(output_file_path, std::ios::out | std::ios::binary);
+		if (!file.is_open()) {
+			file_access_error = true;
+			output_file_path = "output.bin";
+			file.open(output_file_path, std::ios::out | std::ios::binary);
+		}
+
+		std::vector<std::string_view> symbols = token_type_order();
+		auto terminal_count = symbols.size();
+		std::vector<uint32_t> symbol_index(symbol_table.size(), none); // production table id -> blob symbol
+		for (auto& symbol : non_terminal_order()) symbols.push_back(symbol);
+		for (size_t index = 0; index < symbols.size(); index++) {
+			symbol_index[symbol_ids[symbols[index]]] = static_cast<uint32_t>(index);
+		}
+
+		// only the productions build_cc would meet: those of the non-terminals reachable from the goal
+		std::vector<uint32_t> reachable;
+		std::vector<bool> reached(symbol_table.size(), false);
+		std::vector<uint32_t> worklist{ symbol_ids[goal_lhs_symbol] };
+		reached[worklist.back()] = true;
+		while (!worklist.empty()) {
+			auto symbol = worklist.back();
+			worklist.pop_back();
+			for (auto p : symbol_table[symbol].productions) {
+				reachable.push_back(p);
+				for (uint32_t i = 1; i < production_size(p); i++) {
+					auto next = production_begin(p)[i];
+					if (reached[next]) continue;
+					reached[next] = true;
+					worklist.push_back(next);
+				}
+			}
+		}
+		std::sort(reachable.begin(), reachable.end());
+
+		std::map<std::pair<size_t, size_t>, uint32_t> rule_index; // (LHS declaration rank, pop count)
+		for (auto p : reachable) {
+			rule_index.emplace(std::make_pair(declaration_rank[symbol_table[production_begin(p)[0]].name], production_size(p) - 1), 0);
+		}
+		std::vector<std::pair<uint32_t, uint32_t>> rules;
+		for (auto& rule : rule_index) {
+			rule.second = static_cast<uint32_t>(rules.size());
+			rules.emplace_back(symbol_index[symbol_ids[declared_symbols[rule.first.first]]] - terminal_count, rule.first.second);
+		}
+
+		std::vector<uint32_t> production_fields, rhs;
+		for (auto p : reachable) {
+			auto production = production_begin(p);
+			auto lhs = symbol_table[production[0]].name;
+			auto last_terminal = last_terminal_precedence(production_names(p));
+			production_fields.push_back(symbol_index[production[0]] - static_cast<uint32_t>(terminal_count));
+			production_fields.push_back(static_cast<uint32_t>(rhs.size()));
+			production_fields.push_back(production_size(p) - 1);
+			production_fields.push_back(rule_index[std::make_pair(declaration_rank[lhs], production_size(p) - 1)]);
+			production_fields.push_back(static_cast<uint32_t>(production_precedences[p]));
+			production_fields.push_back(static_cast<uint32_t>(last_terminal.first));
+			production_fields.push_back(static_cast<uint32_t>(last_terminal.second[0]));
+			for (uint32_t i = 1; i < production_size(p); i++) rhs.push_back(symbol_index[production[i]]);
+		}
+
+		std::vector<uint32_t> firsts{ 0 }, first_terminals;
+		for (size_t index = terminal_count; index < symbols.size(); index++) {
+			for (auto terminal : symbol_table[symbol_ids[symbols[index]]].firsts) first_terminals.push_back(symbol_index[terminal]);
+			firsts.push_back(static_cast<uint32_t>(first_terminals.size()));
+		}
+		firsts.insert(firsts.end(), first_terminals.begin(), first_terminals.end());
+
+		std::string blob(HEADER_SIZE, '\0');
+		auto set = [&blob](uint32_t offset, size_t value) {
+			auto field = static_cast<uint32_t>(value);
+			std::memcpy(&blob[offset], &field, sizeof(field));
+		};
+		auto append = [&blob](size_t value) {
+			auto field = static_cast<uint32_t>(value);
+			blob.append(reinterpret_cast<const char*>(&field), sizeof(field));
+		};
+		auto append_section = [&](uint32_t header_field, const std::vector<uint32_t>& section) {
+			set(header_field, blob.size());
+			for (auto entry : section) append(entry);
+		};
+
+		// the name bytes go last, so their offsets are known once the fixed-size sections are laid out
+		auto name_bytes = HEADER_SIZE + (symbols.size() * 2 + terminal_count + rules.size() * 2 + production_fields.size() +
+			rhs.size() + firsts.size()) * 4;
+		set(NAMES, blob.size());
+		for (auto& symbol : symbols) {
+			append(name_bytes);
+			append(symbol.size());
+			name_bytes += symbol.size();
+		}
+		set(lazy_tables::TERMINALS, blob.size());
+		for (size_t index = 0; index < terminal_count; index++) {
+			append(static_cast<uint32_t>(terminals.find(Terminal(symbols[index], 0, "n"))->precedence));
+		}
+		set(RULES, blob.size());
+		for (auto& rule : rules) {
+			append(rule.first);
+			append(rule.second);
+		}
+		append_section(lazy_tables::PRODUCTIONS, production_fields);
+		append_section(RHS, rhs);
+		append_section(FIRSTS, firsts);
+		for (auto& symbol : symbols) blob.append(symbol);
+		blob.append((4 - blob.size() % 4) % 4, '\0');
+
+		std::memcpy(&blob[MAGIC], magic, sizeof(magic));
+		set(VERSION, version);
+		set(SIZE, blob.size());
+		set(TERMINAL_COUNT, terminal_count);
+		set(NON_TERMINAL_COUNT, symbols.size() - terminal_count);
+		set(RULE_COUNT, rules.size());
+		set(PRODUCTION_COUNT, reachable.size());
+		set(RHS_SIZE, rhs.size());
+		set(FIRST_SIZE, first_terminals.size());
+		set(GOAL, symbol_index[symbol_ids[goal_lhs_symbol]] - terminal_count);
+		set(LOOKAHEAD, symbol_index[symbol_ids[goal_production_lookahead_symbol]]);
+		set(CHECKSUM, binary_tables::crc32(reinterpret_cast<const unsigned char*>(blob.data()) + CHECKSUM + 4, blob.size() - CHECKSUM - 4));
+
+		file.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+	}
+
+	// Machine-readable report for --stats: the phases timed by 'recorder', followed by the sizes of
+	// the grammar, the canonical collection and the tables, and the occupancy of the hash tables.
+	void write_stats(std::ostream& out, const PhaseRecorder& recorder) {
+		double total_seconds = 0;
+		out << "{\n  \"phases\": [\n";
+		for (size_t i = 0; i < recorder.phases.size(); i++) {
+			auto& phase = recorder.phases[i];
+			total_seconds += phase.seconds;
+			out << "    { \"name\": \"" << phase.name << "\", \"seconds\": " << phase.seconds << ", \"peak_memory_kb\": ";
+			if (phase.peak_memory_kb < 0) out << "null";
+			else out << phase.peak_memory_kb;
+			out << " }" << (i + 1 < recorder.phases.size() ? ",\n" : "\n");
+		}
+		out << "  ],\n"
+			<< "  \"total_seconds\": " << total_seconds << ",\n"
+			<< "  \"peak_memory_scope\": \"" << (recorder.per_phase_peaks ? "phase" : "run") << "\",\n";
+
+		size_t production_count = 0;
+		for (auto& production : productions) production_count += production.second.size();
+		out << "  \"grammar\": { \"terminals\": " << terminals.size() << ", \"non_terminals\": " << non_terminals.size()
+			<< ", \"productions\": " << production_count << ", \"reduce_rules\": " << reduce_info.size() << " },\n";
+
+		size_t items = 0;
+		for (auto& canonicalSet_i : canonicalCollection) items += canonicalSet_i.first.size();
+		out << "  \"canonical_collection\": { \"states\": " << canonicalCollection.size() << ", \"items\": " << items
+			<< ", \"closure_calls\": " << stats.closure_calls << ", \"closure_passes\": " << stats.closure_passes
+			<< ", \"goto_calls\": " << stats.goto_calls << ", \"items_constructed\": " << stats.items_constructed
+			<< ", \"items_added\": " << stats.items_added << ", \"candidate_sets\": " << stats.candidate_sets
+			<< ", \"kernel_states\": " << (kernel_states ? "true" : "false") << ", \"closed_state_hits\": " << stats.closed_state_hits << " },\n";
+
+		size_t action_counts[4] = {};
+		for (auto& entry : actionTable) ++action_counts[entry.second.type];
+		out << "  \"tables\": { \"action_entries\": " << actionTable.size() << ", \"shift\": " << action_counts[SHIFT]
+			<< ", \"reduce\": " << action_counts[REDUCE] << ", \"accept\": " << action_counts[ACCEPT]
+			<< ", \"shift_reduce\": " << action_counts[SHIFT_REDUCE] << ", \"goto_entries\": " << gotoTable.size()
+			<< ", \"default_reductions\": " << default_reductions.size() << " },\n";
+
+		HashTableStats item_sets;
+		for (auto& canonicalSet_i : canonicalCollection) item_sets.add(canonicalSet_i.first);
+		auto table_stats = [](const auto& table) {
+			HashTableStats table_stats;
+			table_stats.add(table);
+			return table_stats;
+		};
+		out << "  \"hash_tables\": {\n";
+		table_stats(strings).write(out, "strings");
+		out << ",\n";
+		table_stats(terminals).write(out, "terminals");
+		out << ",\n";
+		table_stats(productions).write(out, "productions");
+		out << ",\n";
+		table_stats(canonicalCollection).write(out, "canonical_collection");
+		out << ",\n";
+		item_sets.write(out, "item_sets");
+		out << ",\n";
+		table_stats(actionTable).write(out, "action_table");
+		out << ",\n";
+		table_stats(gotoTable).write(out, "goto_table");
+		out << "\n  }\n}\n";
 	}
 };
 
 static inline void print_usage() {
-	std::cout << "usage: ./parsegen <path/to/grammar> [OPTIONAL] <path/to/output/file>\n       ./parsegen -h or ./parsegen -H for help information\n\n";
+	std::cout << "usage: ./parsegen <path/to/grammar> [OPTIONAL] <path/to/output/file> [OPTIONS]\n       ./parsegen -h or ./parsegen -H for help information\n\n"
+		<< "options:\n"
+		<< "  --simplify            remove useless non-terminals, inline single-use ones\n"
+		<< "  --chain-elim          bypass unit productions ('A > B') in the generated tables\n"
+		<< "  --keep <A>[,<B>...]   never optimize away reductions to these non-terminals\n"
+		<< "  --default-reductions  emit per-state default reductions and fused SHIFT_REDUCE actions\n"
+		<< "  --emit-binary         write the tables as a binary blob for runtime/binary-tables.h (default: output.bin)\n"
+		<< "  --emit-code           write the parser as code, a block per state, instead of tables\n"
+		<< "  --emit-recognizer     write a recognizer only (valid or not, and where), over flat arrays\n"
+		<< "  --emit-lazy           write the grammar as a blob for runtime/lazy-tables.h, which builds the tables at parse time\n"
+		<< "  --profile <corpus>    number states and terminals by how often parsing the corpus uses them\n"
+		<< "  --split               write declarations to the output header, and the table data to a .cpp file beside it\n"
+		<< "  --kernel-states       store only the kernel items of every state, and recompute closures (less memory)\n"
+		<< "  --cache <dir>         reuse the output of an earlier run with the same grammar and options\n"
+		<< "    --cache-limit <MiB>      evict least recently used outputs beyond this size (default: 64)\n"
+		<< "  --stats <file>        write per-phase timings, peak memory and table statistics to a JSON file\n"
+		<< "  --sentences <count>   write random sentences of the grammar, one per line, to a file:\n"
+		<< "    --sentences-out <file>   (default: sentences.txt)\n"
+		<< "    --depth <max>            nested expansions per derivation (default: 32)\n"
+		<< "    --length [<min>:]<max>   terminals per sentence (default: unbounded)\n"
+		<< "    --weights <file>         relative weights of productions, '<weight> <LHS> > <RHS>' per line\n"
+		<< "    --seed <seed>            random seed (default: 1)\n\n";
 }
 
 static inline void print_help() {
@@ -962,11 +3140,18 @@ static inline void print_help() {
 		<< "REDUCE-REDUCE conflicts\n=======================\n\n"
 		<< "In some cases, the language is ill-formed and the grammar specification on REDUCE actions is unclear. That is, more than one rules/productions have the same LHS.\n\n"
 		<< "This is a fatal error that results in the parser generator terminating early with an error message identifying the rules/productions leading to ambiguous REDUCE actions.\n\n"
+		<< "Optimizations\n=============\n\n"
+		<< "--simplify: Before the canonical collection is built, non-terminals that can never derive a string of terminals, or cannot be reached from the goal production, are removed along with their productions. A non-terminal with a single production that is used exactly once is inlined into the production using it. The goal, non-terminals listed with --keep, recursive rules, rules with an explicit precedence or containing terminals with precedence/associativity, and rules that would change the precedence of the production using them are never inlined. Every change is reported.\n\n"
+		<< "--chain-elim: A unit production 'A > B' makes the parser reduce B to A right after reducing B, without consuming input. With this option, the generated goto table jumps straight past such reductions, and the states that only performed them are removed. The parse function never sees these reductions to A, so any non-terminal it dispatches on must be listed with --keep.\n\n"
+		<< "--default-reductions: A state whose only action is the same REDUCE for every next token gets a default reduction (default_reductions[state]) instead of a row in the action table. A SHIFT into such a state becomes a SHIFT_REDUCE action: consume the token, then REDUCE by reduce_info[value], popping one state less since the state shifted into is never pushed.\n\n"
+		<< "--emit-binary: Instead of a header, the tables are written as a versioned, checksummed binary blob that runtime/binary-tables.h memory-maps and parses with in place. Terminals are numbered like TokenType and rules like reduce_info. The action and goto tables are packed by row displacement, so a lookup is a single indexed load and compare. The blob can be regenerated and reloaded without rebuilding the parser.\n\n"
+		<< "--emit-recognizer: Instead of tables, the header holds a recognizer, recognize(), which only tells whether the tokens are valid and, if not, the index of the token the parse stopped at. The automaton is written as flat arrays of the narrowest types: a dense action table, the pop count of every rule, and a composite reduce/goto table indexed by the uncovered state and the rule. There is no reduce_info and no callback.\n\n"
+		<< "--profile <corpus>: Every line of the corpus file is a sentence of whitespace-separated terminals (e.g. 't_NUMBER t_PLUS t_NUMBER'; lines starting with '#' are ignored). Each sentence is parsed with the generated tables, and the states are renumbered by how often they were used (state 0 remains the start state), hottest first. Terminals are ordered in TokenType by how often they were shifted, and the table entries are written hottest row first. The corpus may also be a CSV file of counters exported by a parser instrumented with runtime/parse-profile.h, built from tables generated with the same grammar and options.\n\n"
 		<< "Check the 'math-expressions/' and 'parentheses/' directories for example parsers and further understanding.\n";
 }
 
 int main(int argc, char** argv) {
-	if (argc < 2 || argc > 3) {
+	if (argc < 2) {
 		print_usage();
 		exit(1);
 	}
@@ -975,37 +3160,292 @@ int main(int argc, char** argv) {
 	   (argv[1][1] == 'h' || argv[1][1] == 'H')) {
 		print_help();
 		exit(1);
-	} else if (argv[1][0] == '-'){
+	} else if (argv[1][0] == '-' && argv[1][1] != '-'){
 		print_usage();
 		exit(1);
 	}
 
-	ParserGen parserGen(argc, argv);
+	// grammar and output file paths are positional, everything else is an option
+	std::vector<char*> positional_args{ argv[0] };
+	bool simplify = false;
+	bool chain_elim = false;
+	bool default_reductions = false;
+	bool emit_binary = false;
+	bool emit_lazy = false;
+	bool emit_code = false;
+	bool emit_recognizer = false;
+	bool split = false;
+	bool kernel_states = false;
+	std::string profile_path;
+	std::string cache_dir;
+	uintmax_t cache_limit_mb = 64;
+	std::string stats_path;
+	std::vector<std::string> preserved_symbols;
+	size_t sentence_count = 0;
+	std::string sentences_path = "sentences.txt";
+	std::string weights_path;
+	size_t sentence_depth = 32;
+	size_t sentence_min_length = 0, sentence_max_length = 0;
+	unsigned sentence_seed = 1;
+
+	for (auto i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg.rfind("--", 0) != 0) {
+			positional_args.push_back(argv[i]);
+		}
+		else if (arg == "--simplify") {
+			simplify = true;
+		}
+		else if (arg == "--chain-elim") {
+			chain_elim = true;
+		}
+		else if (arg == "--default-reductions") {
+			default_reductions = true;
+		}
+		else if (arg == "--emit-binary") {
+			emit_binary = true;
+		}
+		else if (arg == "--emit-lazy") {
+			emit_lazy = true;
+		}
+		else if (arg == "--emit-code") {
+			emit_code = true;
+		}
+		else if (arg == "--emit-recognizer") {
+			emit_recognizer = true;
+		}
+		else if (arg == "--split") {
+			split = true;
+		}
+		else if (arg == "--kernel-states") {
+			kernel_states = true;
+		}
+		else if (arg == "--profile" && i + 1 < argc) {
+			profile_path = argv[++i];
+		}
+		else if (arg == "--cache" && i + 1 < argc) {
+			cache_dir = argv[++i];
+		}
+		else if (arg == "--cache-limit" && i + 1 < argc && std::strtoul(argv[i + 1], nullptr, 10) > 0) {
+			cache_limit_mb = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--stats" && i + 1 < argc) {
+			stats_path = argv[++i];
+		}
+		else if (arg == "--sentences" && i + 1 < argc && std::strtoul(argv[i + 1], nullptr, 10) > 0) {
+			sentence_count = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--sentences-out" && i + 1 < argc) {
+			sentences_path = argv[++i];
+		}
+		else if (arg == "--weights" && i + 1 < argc) {
+			weights_path = argv[++i];
+		}
+		else if (arg == "--depth" && i + 1 < argc && std::strtoul(argv[i + 1], nullptr, 10) > 0) {
+			sentence_depth = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--length" && i + 1 < argc) {
+			// <max> or <min>:<max>
+			std::string range = argv[++i];
+			auto colon = range.find(':');
+			sentence_min_length = colon == std::string::npos ? 0 : std::strtoul(range.c_str(), nullptr, 10);
+			sentence_max_length = std::strtoul(range.c_str() + (colon == std::string::npos ? 0 : colon + 1), nullptr, 10);
+		}
+		else if (arg == "--seed" && i + 1 < argc) {
+			sentence_seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (arg == "--keep" && i + 1 < argc) {
+			std::stringstream symbols(argv[++i]);
+			std::string symbol;
+			while (std::getline(symbols, symbol, ',')) {
+				if (symbol != "") preserved_symbols.push_back(symbol);
+			}
+		}
+		else {
+			std::cout << "Unknown or incomplete option '" << arg << "'\n";
+			print_usage();
+			exit(1);
+		}
+	}
+
+	if (positional_args.size() < 2 || positional_args.size() > 3) {
+		print_usage();
+		exit(1);
+	}
+
+	if (emit_recognizer && (emit_code || emit_lazy || emit_binary || split)) {
+		std::cout << "\n--emit-recognizer: ignoring --emit-code, --emit-lazy, --emit-binary and --split.\n";
+		emit_code = emit_lazy = emit_binary = split = false;
+	}
+
+	if (emit_code && (emit_lazy || emit_binary || split)) {
+		std::cout << "\n--emit-code: ignoring --emit-lazy, --emit-binary and --split.\n";
+		emit_lazy = emit_binary = split = false;
+	}
+
+	// the lazy runtime builds plain tables from the grammar, so the table optimizations have nothing to apply to
+	if (emit_lazy && (chain_elim || default_reductions || !profile_path.empty() || emit_binary || split)) {
+		std::cout << "\n--emit-lazy: ignoring --chain-elim, --default-reductions, --profile, --emit-binary and --split.\n";
+		chain_elim = default_reductions = emit_binary = split = false;
+		profile_path.clear();
+	}
+
+	PhaseRecorder recorder(!stats_path.empty());
+	recorder.begin("read_grammar");
+	ParserGen parserGen(static_cast<int>(positional_args.size()), positional_args.data());
 	parserGen.debug = false;
+	parserGen.eliminate_chain_productions = chain_elim;
+	parserGen.use_default_reductions = default_reductions;
+	parserGen.split_output = split && !emit_binary && !emit_lazy && !emit_code && !emit_recognizer;
+	parserGen.kernel_states = kernel_states;
+	if ((emit_binary || emit_lazy) && positional_args.size() == 2) parserGen.output_file_path = "output.bin";
+	parserGen.preserved_symbols.insert(preserved_symbols.begin(), preserved_symbols.end());
+	parserGen.sentence_max_depth = sentence_depth;
+	parserGen.sentence_min_length = sentence_min_length;
+	parserGen.sentence_max_length = sentence_max_length;
+	parserGen.sentence_seed = sentence_seed;
 
 	if (parserGen.file_access_error) {
-		std::cout << "\nUnable to open " << argv[1] << " file.\n\n";
+		std::cout << "\nUnable to open " << positional_args[1] << " file.\n\n";
 		return -1;
 	}
 
+	recorder.begin("get_terminals_and_productions");
 	if (!parserGen.get_terminals_and_productions()) {
 		std::cout << "\nFatal error in grammar definition. Parser-Generator terminated early.\n\n";
 		return -1;
 	}
 
+	recorder.begin("check_symbols_in_productions");
 	if (!parserGen.check_symbols_in_productions()) {
 		std::cout << "\nFatal Error in grammar definition. Parser-Generator terminated early.\n\n";
 		return -1;
 	}
 
-	parserGen.build_cc();
-	parserGen.build_tables();
-	parserGen.build_output_file();
+	if (simplify) {
+		recorder.begin("simplify_grammar");
+		if (!parserGen.simplify_grammar()) {
+			std::cout << "\nFatal Error in grammar definition. Parser-Generator terminated early.\n\n";
+			return -1;
+		}
+
+		std::cout << "\nGrammar simplification: " << (parserGen.simplification_report.empty() ? "nothing to simplify.\n" : "\n");
+		for (auto& line : parserGen.simplification_report) {
+			std::cout << "  " << line << "\n";
+		}
+	}
+
+	if (sentence_count) {
+		recorder.begin("generate_sentences");
+		if (!weights_path.empty() && !parserGen.read_production_weights(weights_path)) {
+			std::cout << "\nUnable to open " << weights_path << " file.\n\n";
+			return -1;
+		}
+
+		bool generated = parserGen.generate_sentences(sentence_count, sentences_path);
+		std::cout << "\nSentences:\n";
+		for (auto& line : parserGen.sentence_report) {
+			std::cout << "  " << line << "\n";
+		}
+		if (!generated) {
+			std::cout << "\nUnable to write sentences to " << sentences_path << ".\n\n";
+			return -1;
+		}
+	}
+
+	// the cache key covers every option that changes the output, and the profile it is generated with
+	std::string cache_key;
+	bool cache_hit = false;
+	if (!cache_dir.empty()) {
+		recorder.begin("cache_lookup");
+		std::stringstream options;
+		options << "simplify=" << simplify << " chain_elim=" << chain_elim << " default_reductions=" << default_reductions
+			<< " emit_binary=" << emit_binary << " emit_lazy=" << emit_lazy << " emit_code=" << emit_code
+			<< " emit_recognizer=" << emit_recognizer << " keep=";
+		std::sort(preserved_symbols.begin(), preserved_symbols.end());
+		for (auto& symbol : preserved_symbols) options << symbol << ",";
+		// split output names its files in their contents
+		if (parserGen.split_output) options << " split=" << std::filesystem::path(parserGen.output_file_path).filename().string();
+		if (!profile_path.empty()) {
+			std::ifstream profile(profile_path, std::ios::in | std::ios::binary);
+			options << " profile=" << profile.rdbuf();
+		}
+		cache_key = parserGen.cache_key(options.str());
+		cache_hit = parserGen.restore_from_cache(cache_dir, cache_key, emit_binary || emit_lazy);
+		recorder.end();
+	}
+
+	if (!cache_hit && !emit_lazy) {
+		recorder.begin("build_cc");
+		parserGen.build_cc();
+		recorder.begin("build_tables");
+		parserGen.build_tables();
+		recorder.end();
+	}
+
+	if (chain_elim && !cache_hit) {
+		std::cout << "\nChain-rule elimination: " << parserGen.chain_reductions_bypassed << " goto entries redirected past unit productions, "
+			<< parserGen.chain_states_removed << " states removed.\n";
+	}
+
+	if (default_reductions && !cache_hit) {
+		std::cout << "\nDefault reductions: " << parserGen.default_reduction_entries_removed << " action table entries replaced, "
+			<< parserGen.shift_reduce_actions_fused << " SHIFT_REDUCE actions fused, "
+			<< parserGen.default_reduction_states_removed << " states removed.\n";
+	}
+
+	if (!profile_path.empty() && !cache_hit) {
+		recorder.begin("apply_profile");
+		if (!parserGen.apply_profile(profile_path)) {
+			std::cout << "\nUnable to open " << profile_path << " file.\n\n";
+			return -1;
+		}
+
+		std::cout << "\nProfile:\n";
+		for (auto& line : parserGen.profile_report) {
+			std::cout << "  " << line << "\n";
+		}
+	}
+
+	if (!cache_hit) {
+		recorder.begin("build_output_file");
+		if (emit_lazy) parserGen.build_lazy_output_file();
+		else if (emit_binary) parserGen.build_binary_output_file();
+		else if (emit_code) parserGen.build_code_output_file();
+		else if (emit_recognizer) parserGen.build_recognizer_output_file();
+		else if (parserGen.split_output) parserGen.build_split_output_files();
+		else parserGen.build_output_file();
+
+		if (!cache_dir.empty()) {
+			recorder.begin("cache_store");
+			parserGen.store_in_cache(cache_dir, cache_key, cache_limit_mb * 1024 * 1024);
+		}
+		recorder.end();
+	}
+
+	if (!cache_dir.empty()) {
+		std::cout << "\nCache:\n";
+		for (auto& line : parserGen.cache_report) {
+			std::cout << "  " << line << "\n";
+		}
+	}
+
+	if (!stats_path.empty()) {
+		std::ofstream stats_file(stats_path, std::ios::out);
+		if (!stats_file.is_open()) {
+			std::cout << "\nUnable to write statistics to " << stats_path << ".\n";
+		}
+		else {
+			parserGen.write_stats(stats_file, recorder);
+		}
+	}
 
 	if (parserGen.file_access_error) {
-		std::cout << "\nParse tables generated successfully. Invalid output file directory. Parse tables have been written to '" << parserGen.output_file_path << "' instead.\n\n";
+		std::cout << "\nParse tables generated successfully. Invalid output file directory. Parse tables have been written to '" << parserGen.output_file_path
+			<< (parserGen.data_file_path.empty() ? "" : "' and '" + parserGen.data_file_path) << "' instead.\n\n";
 		return -1;
 	}
 
-	std::cout << "\nParse tables have been generated and written to '" << parserGen.output_file_path << "' successfully!\n\n";
+	std::cout << "\nParse tables have been generated and written to '" << parserGen.output_file_path
+		<< (parserGen.data_file_path.empty() ? "" : "' and '" + parserGen.data_file_path) << "' successfully!\n\n";
 }
@@ -0,0 +1,386 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PARSEGEN_BINARY_TABLES_MMAP
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+// Binary parse tables, as written by 'parsegen --emit-binary', and a runtime that parses with them
+// in place: the blob is memory-mapped and read where it lies, without a deserialization step, so a
+// program can load (or swap) a grammar's tables at startup without being rebuilt.
+//
+// Layout. All integers are little-endian u32, all offsets are from the start of the blob (so it is
+// position-independent), and every section is 4-byte aligned:
+//
+//   header               the fields of HeaderField
+//   names                (terminal_count + non_terminal_count) x { offset, length } of the symbol names,
+//                        terminals first (in TokenType order), then non-terminals
+//   rules                rule_count x { lhs (non-terminal index), pop count }, indexed like reduce_info
+//   action base/check/value, goto base/check/value
+//                        row-displacement packed tables: the entry of (state, column) is in slot
+//                        base[state] + column if check[slot] == state; action values hold the ActionKind
+//                        in their top 2 bits and the SHIFT target state or REDUCE rule below
+//   default reductions   state_count x rule index (or 'none'); only with the has_default_reductions flag
+//   symbol name bytes
+//
+// The checksum is the CRC-32 of every byte following it. Big-endian hosts are not supported.
+
+namespace binary_tables {
+
+constexpr char magic[4] = { 'P', 'G', 'T', 'B' };
+constexpr uint32_t version = 1;
+constexpr uint32_t none = 0xffffffff;
+
+// flags
+constexpr uint32_t has_default_reductions = 1;
+
+// Byte offsets of the header fields
+enum HeaderField : uint32_t {
+	MAGIC = 0,
+	VERSION = 4,
+	SIZE = 8,
+	CHECKSUM = 12,
+	FLAGS = 16,
+	STATE_COUNT = 20,
+	TERMINAL_COUNT = 24,
+	NON_TERMINAL_COUNT = 28,
+	RULE_COUNT = 32,
+	NAMES = 36,
+	RULES = 40,
+	ACTION_BASE = 44,
+	ACTION_SLOTS = 48,
+	ACTION_CHECK = 52,
+	ACTION_VALUE = 56,
+	GOTO_BASE = 60,
+	GOTO_SLOTS = 64,
+	GOTO_CHECK = 68,
+	GOTO_VALUE = 72,
+	DEFAULT_REDUCTIONS = 76,
+	HEADER_SIZE = 80
+};
+
+enum ActionKind : uint32_t {
+	SHIFT,
+	REDUCE,
+	ACCEPT,
+	SHIFT_REDUCE
+};
+
+constexpr uint32_t kind_shift = 30;
+constexpr uint32_t value_mask = (1u << kind_shift) - 1;
+
+inline uint32_t crc32(const unsigned char* data, size_t size) {
+	static const auto table = [] {
+		std::array<uint32_t, 256> entries{};
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320u : 0);
+			entries[i] = crc;
+		}
+		return entries;
+	}();
+
+	uint32_t crc = 0xffffffffu;
+	for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return crc ^ 0xffffffffu;
+}
+
+struct Action {
+	ActionKind kind;
+	uint32_t value;
+};
+
+class Tables {
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+
+	// set by open(): the mapping (or, without mmap, the file contents) backing 'data'
+	void* mapping = nullptr;
+	size_t mapping_size = 0;
+	std::vector<unsigned char> contents;
+
+	uint32_t states = 0, terminals = 0, non_terminals = 0, rules = 0;
+	const unsigned char* names = nullptr;
+	const unsigned char* rule_info = nullptr;
+	const unsigned char* action_base = nullptr;
+	const unsigned char* action_check = nullptr;
+	const unsigned char* action_value = nullptr;
+	const unsigned char* goto_base = nullptr;
+	const unsigned char* goto_check = nullptr;
+	const unsigned char* goto_value = nullptr;
+	const unsigned char* default_reductions = nullptr;
+	uint32_t action_slots = 0, goto_slots = 0;
+
+	static uint32_t load(const unsigned char* at) {
+		uint32_t value;
+		std::memcpy(&value, at, sizeof(value));
+		return value;
+	}
+
+	uint32_t field(uint32_t offset) const {
+		return load(data + offset);
+	}
+
+	// 'count' u32s at 'offset' fit in the blob
+	bool section_fits(uint32_t offset, uint64_t count) const {
+		return offset >= HEADER_SIZE && offset % 4 == 0 && offset + count * 4 <= size;
+	}
+
+	void release() {
+#ifdef PARSEGEN_BINARY_TABLES_MMAP
+		if (mapping) munmap(mapping, mapping_size);
+#endif
+		mapping = nullptr;
+		mapping_size = 0;
+		contents.clear();
+		data = nullptr;
+		size = 0;
+	}
+
+	bool validate(std::string& error, bool verify_checksum) {
+		uint32_t probe = 1;
+		unsigned char first_byte;
+		std::memcpy(&first_byte, &probe, 1);
+		if (first_byte != 1) return error = "big-endian hosts are not supported", false;
+
+		if (size < HEADER_SIZE || std::memcmp(data, magic, sizeof(magic)) != 0) return error = "not a parse table blob", false;
+		if (field(VERSION) != version) return error = "unsupported version " + std::to_string(field(VERSION)), false;
+		if (field(SIZE) != size) return error = "truncated blob", false;
+		if (verify_checksum && crc32(data + CHECKSUM + 4, size - CHECKSUM - 4) != field(CHECKSUM)) return error = "checksum mismatch", false;
+
+		states = field(STATE_COUNT);
+		terminals = field(TERMINAL_COUNT);
+		non_terminals = field(NON_TERMINAL_COUNT);
+		rules = field(RULE_COUNT);
+		action_slots = field(ACTION_SLOTS);
+		goto_slots = field(GOTO_SLOTS);
+		bool with_default_reductions = field(FLAGS) & has_default_reductions;
+
+		if (states == 0 ||
+			!section_fits(field(NAMES), (static_cast<uint64_t>(terminals) + non_terminals) * 2) ||
+			!section_fits(field(RULES), static_cast<uint64_t>(rules) * 2) ||
+			!section_fits(field(ACTION_BASE), states) || !section_fits(field(ACTION_CHECK), action_slots) ||
+			!section_fits(field(ACTION_VALUE), action_slots) || !section_fits(field(GOTO_BASE), states) ||
+			!section_fits(field(GOTO_CHECK), goto_slots) || !section_fits(field(GOTO_VALUE), goto_slots) ||
+			(with_default_reductions && !section_fits(field(DEFAULT_REDUCTIONS), states)))
+		{
+			return error = "section out of bounds", false;
+		}
+
+		names = data + field(NAMES);
+		rule_info = data + field(RULES);
+		action_base = data + field(ACTION_BASE);
+		action_check = data + field(ACTION_CHECK);
+		action_value = data + field(ACTION_VALUE);
+		goto_base = data + field(GOTO_BASE);
+		goto_check = data + field(GOTO_CHECK);
+		goto_value = data + field(GOTO_VALUE);
+		default_reductions = with_default_reductions ? data + field(DEFAULT_REDUCTIONS) : nullptr;
+
+		// every index the parse functions follow must stay in range
+		for (uint32_t symbol = 0; symbol < terminals + non_terminals; symbol++) {
+			if (static_cast<uint64_t>(load(names + symbol * 8)) + load(names + symbol * 8 + 4) > size) return error = "symbol name out of bounds", false;
+		}
+		for (uint32_t rule = 0; rule < rules; rule++) {
+			if (load(rule_info + rule * 8) >= non_terminals) return error = "rule with an invalid LHS", false;
+		}
+		for (uint32_t slot = 0; slot < action_slots; slot++) {
+			auto owner = load(action_check + slot * 4);
+			if (owner == none) continue;
+			auto value = load(action_value + slot * 4);
+			auto kind = value >> kind_shift;
+			if (owner >= states || (kind == SHIFT && (value & value_mask) >= states) ||
+				((kind == REDUCE || kind == SHIFT_REDUCE) && (value & value_mask) >= rules))
+			{
+				return error = "invalid action table entry", false;
+			}
+		}
+		for (uint32_t slot = 0; slot < goto_slots; slot++) {
+			auto owner = load(goto_check + slot * 4);
+			if (owner != none && (owner >= states || load(goto_value + slot * 4) >= states)) return error = "invalid goto table entry", false;
+		}
+		for (uint32_t state = 0; default_reductions && state < states; state++) {
+			auto rule = load(default_reductions + state * 4);
+			if (rule != none && rule >= rules) return error = "invalid default reduction", false;
+		}
+		return true;
+	}
+
+public:
+	Tables() = default;
+	Tables(const Tables&) = delete;
+	Tables& operator=(const Tables&) = delete;
+
+	~Tables() {
+		release();
+	}
+
+	// Map the blob at 'path' and validate it. On failure, 'error' says why.
+	bool open(const std::string& path, std::string& error, bool verify_checksum = true) {
+		release();
+#ifdef PARSEGEN_BINARY_TABLES_MMAP
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) return error = "unable to open " + path, false;
+		struct stat status;
+		if (fstat(fd, &status) < 0 || status.st_size <= 0) {
+			::close(fd);
+			return error = "unable to read " + path, false;
+		}
+		mapping_size = static_cast<size_t>(status.st_size);
+		mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (mapping == MAP_FAILED) {
+			mapping = nullptr;
+			return error = "unable to map " + path, false;
+		}
+		data = static_cast<const unsigned char*>(mapping);
+		size = mapping_size;
+#else
+		std::ifstream file(path, std::ios::in | std::ios::binary);
+		if (!file.is_open()) return error = "unable to open " + path, false;
+		contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		data = contents.data();
+		size = contents.size();
+#endif
+		if (!validate(error, verify_checksum)) {
+			release();
+			return false;
+		}
+		return true;
+	}
+
+	// Use a blob held in memory; it must outlive these tables.
+	bool attach(const void* blob, size_t blob_size, std::string& error, bool verify_checksum = true) {
+		release();
+		data = static_cast<const unsigned char*>(blob);
+		size = blob_size;
+		if (!validate(error, verify_checksum)) {
+			release();
+			return false;
+		}
+		return true;
+	}
+
+	uint32_t state_count() const { return states; }
+	uint32_t terminal_count() const { return terminals; }
+	uint32_t non_terminal_count() const { return non_terminals; }
+	uint32_t rule_count() const { return rules; }
+
+	std::string_view terminal_name(uint32_t terminal) const {
+		return std::string_view(reinterpret_cast<const char*>(data) + load(names + terminal * 8), load(names + terminal * 8 + 4));
+	}
+
+	std::string_view non_terminal_name(uint32_t non_terminal) const {
+		return terminal_name(terminals + non_terminal);
+	}
+
+	// Index of a terminal (the TokenType value of the header tables), or 'none'. A linear search,
+	// meant for mapping a scanner's tokens once, at startup.
+	uint32_t terminal(std::string_view name) const {
+		for (uint32_t terminal = 0; terminal < terminals; terminal++) {
+			if (terminal_name(terminal) == name) return terminal;
+		}
+		return none;
+	}
+
+	uint32_t non_terminal(std::string_view name) const {
+		for (uint32_t non_terminal = 0; non_terminal < non_terminals; non_terminal++) {
+			if (non_terminal_name(non_terminal) == name) return non_terminal;
+		}
+		return none;
+	}
+
+	// reduce_info[rule].first, as a non-terminal index
+	uint32_t rule_lhs(uint32_t rule) const {
+		return load(rule_info + rule * 8);
+	}
+
+	// reduce_info[rule].second
+	uint32_t rule_pop_count(uint32_t rule) const {
+		return load(rule_info + rule * 8 + 4);
+	}
+
+	bool action(uint32_t state, uint32_t terminal, Action& out) const {
+		uint64_t slot = static_cast<uint64_t>(load(action_base + state * 4)) + terminal;
+		if (slot >= action_slots || load(action_check + slot * 4) != state) return false;
+		auto value = load(action_value + slot * 4);
+		out = { static_cast<ActionKind>(value >> kind_shift), value & value_mask };
+		return true;
+	}
+
+	bool goto_state(uint32_t state, uint32_t non_terminal, uint32_t& next) const {
+		uint64_t slot = static_cast<uint64_t>(load(goto_base + state * 4)) + non_terminal;
+		if (slot >= goto_slots || load(goto_check + slot * 4) != state) return false;
+		next = load(goto_value + slot * 4);
+		return true;
+	}
+
+	// The rule 'state' reduces by regardless of the next token, or 'none'
+	uint32_t default_reduction(uint32_t state) const {
+		return default_reductions ? load(default_reductions + state * 4) : none;
+	}
+
+	// Parse 'tokens' (terminal indices, ending with the goal lookahead terminal), with 'states' as the
+	// state stack. on_shift(position) is called for every token shifted, on_reduce(rule) after every
+	// reduction, as the parse functions of the header tables do. Returns false on a syntax error.
+	template<typename OnShift, typename OnReduce>
+	bool parse(const uint32_t* tokens, size_t count, std::vector<uint32_t>& states, OnShift&& on_shift, OnReduce&& on_reduce) const {
+		states.clear();
+		states.push_back(0);
+
+		for (size_t i = 0; i < count;) {
+			auto state = states.back();
+			uint32_t rule;
+			uint32_t pop_count;
+
+			auto default_rule = default_reduction(state);
+			if (default_rule != none) {
+				rule = default_rule;
+				pop_count = rule_pop_count(rule);
+			}
+			else {
+				Action next;
+				if (tokens[i] >= terminals || !action(state, tokens[i], next)) return false;
+				if (next.kind == ACCEPT) return true;
+				if (next.kind == REDUCE) {
+					rule = next.value;
+					pop_count = rule_pop_count(rule);
+				}
+				else {
+					on_shift(i);
+					++i;
+					if (next.kind == SHIFT) {
+						states.push_back(next.value);
+						continue;
+					}
+					// the shifted state is never pushed, so there is one state less to pop
+					rule = next.value;
+					pop_count = rule_pop_count(rule) - 1;
+				}
+			}
+
+			if (pop_count >= states.size()) return false;
+			states.resize(states.size() - pop_count);
+			uint32_t next_state;
+			if (!goto_state(states.back(), rule_lhs(rule), next_state)) return false;
+			states.push_back(next_state);
+			on_reduce(rule);
+		}
+		return false;
+	}
+};
+
+} // namespace binary_tables
@@ -0,0 +1,597 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "binary-tables.h"
+
+// LR(1) parse tables built by the compiler, from a grammar written in the program itself: no parsegen
+// step, no generated file. The grammar is a character array (or std::string_view) in the syntax of
+// grammar files, and constexpr_tables::tables<grammar> is a constexpr Tables object holding its action
+// and goto tables, which any parse can read and the compiler can fold lookups into:
+//
+//   static constexpr char paren_grammar[] = "t_EOF\nt_LP\nt_RP\n\nGoal > List\nList > List Pair\n...";
+//   constexpr auto& paren_tables = constexpr_tables::tables<paren_grammar>;
+//
+// Builder runs the pipeline of the generator: it reads and checks the grammar, builds the canonical
+// collection breadth-first from the start state, following the SHIFT actions and gotos of every state
+// in declaration order of their symbols, and resolves conflicts the way build_tables does. The result
+// is the tables 'parsegen' writes without options, numbered the same way: symbols and rules as in the
+// binary tables (TokenType order, non-terminal declaration order, reduce_info order), states as in the
+// generated header. States that only a SHIFT discarded for a REDUCE leads to are not built; no parse
+// reaches them.
+//
+// Everything is evaluated at compile time, within the compiler's constexpr limits, so this is meant for
+// small grammars: the capacities below bound them, and a grammar beyond one is an error. An error in the
+// grammar fails the static_assert in make_tables(), which shows the line in error; Builder::error() has
+// the message.
+
+namespace constexpr_tables {
+
+using binary_tables::Action;
+using binary_tables::ActionKind;
+constexpr uint32_t none = binary_tables::none;
+
+// Capacities of the builder. Lookahead sets are 64-bit masks, hence the number of terminals.
+constexpr size_t max_terminals = 64;
+constexpr size_t max_non_terminals = 64;
+constexpr size_t max_productions = 128;
+constexpr size_t max_rhs_symbols = 512;
+constexpr size_t max_states = 256;
+constexpr size_t max_kernel_items = 2048;
+
+class Builder {
+	// (production, dot) pairs: the items of a state differ only in their lookaheads
+	static constexpr size_t max_cores = max_rhs_symbols + max_productions;
+
+	struct Terminal {
+		std::string_view name;
+		int precedence = 0;
+		char associativity = 'n';
+	};
+
+	// The last terminal of the RHS decides SHIFT-REDUCE conflicts on the production, along with its precedence
+	struct Production {
+		std::string_view text;
+		size_t line = 0;
+		uint32_t lhs = 0, rhs = 0, length = 0, core = 0, rule = none;
+		int precedence = 0, last_terminal_precedence = 0;
+		char last_terminal_associativity = 'n';
+	};
+
+	struct KernelItem {
+		uint32_t core = 0;
+		uint64_t lookaheads = 0;
+	};
+
+	using Lookaheads = std::array<uint64_t, max_cores>;
+	using Kernel = std::array<KernelItem, max_cores>;
+
+	// the grammar. RHS symbols are a terminal index, or max_terminals + a non-terminal index.
+	std::array<Terminal, max_terminals> terminals{};
+	std::array<std::string_view, max_non_terminals> non_terminals{};
+	std::array<Production, max_productions> productions{};
+	std::array<uint32_t, max_rhs_symbols> rhs{};
+	std::array<uint32_t, max_non_terminals + 1> lhs_productions{}; // productions of a non-terminal, sorted by LHS
+	std::array<uint64_t, max_non_terminals> firsts{};              // lookaheads closures take after a non-terminal
+	std::array<uint32_t, max_cores> core_productions{};
+	std::array<uint32_t, max_productions> rule_lhs_symbols{}, rule_pop_counts{};
+	size_t terminal_total = 0, non_terminal_total = 0, production_total = 0, rhs_total = 0, core_total = 0, rule_total = 0;
+
+	// the canonical collection: the kernel of state s is kernel_items[kernels[s], kernels[s + 1])
+	std::array<KernelItem, max_kernel_items> kernel_items{};
+	std::array<uint32_t, max_states + 1> kernels{};
+	std::array<uint32_t, max_states * max_terminals> actions{};
+	std::array<uint32_t, max_states * max_non_terminals> gotos{};
+	size_t state_total = 0;
+
+	const char* error_message = nullptr;
+	size_t error_line_number = 0;
+
+	static constexpr bool is_whitespace(char c) {
+		return c == ' ' || c == '\r' || c == '\t';
+	}
+
+	static constexpr bool is_terminal_name(std::string_view name) {
+		return name.size() >= 2 && name[0] == 't' && name[1] == '_';
+	}
+
+	// The next whitespace-separated field of 'line' from 'position' on, empty at the end of the line
+	static constexpr std::string_view next_field(std::string_view line, size_t& position) {
+		while (position < line.size() && is_whitespace(line[position])) position++;
+		auto start = position;
+		while (position < line.size() && !is_whitespace(line[position])) position++;
+		return line.substr(start, position - start);
+	}
+
+	enum class IntegerField { VALID, INVALID, OUT_OF_RANGE };
+
+	// parse_integer of the generator: an optionally signed integer, ignoring anything after it
+	static constexpr IntegerField parse_integer(std::string_view field, int& value) {
+		size_t i = 0;
+		if (field.size() > 1 && field[0] == '+' && field[1] != '-') i++;
+		bool negative = i < field.size() && field[i] == '-';
+		if (negative) i++;
+		if (i == field.size() || field[i] < '0' || field[i] > '9') return IntegerField::INVALID;
+
+		long long parsed = 0;
+		for (; i < field.size() && field[i] >= '0' && field[i] <= '9'; i++) {
+			parsed = parsed * 10 + (field[i] - '0');
+			if (parsed > 2147483648LL) return IntegerField::OUT_OF_RANGE;
+		}
+		if (negative) parsed = -parsed;
+		if (parsed > 2147483647LL) return IntegerField::OUT_OF_RANGE;
+		value = static_cast<int>(parsed);
+		return IntegerField::VALID;
+	}
+
+	constexpr bool fail(const char* message, size_t line) {
+		error_message = message;
+		error_line_number = line;
+		return false;
+	}
+
+	constexpr uint32_t find_terminal(std::string_view name) const {
+		for (uint32_t terminal = 0; terminal < terminal_total; terminal++) {
+			if (terminals[terminal].name == name) return terminal;
+		}
+		return none;
+	}
+
+	constexpr uint32_t find_non_terminal(std::string_view name) const {
+		for (uint32_t non_terminal = 0; non_terminal < non_terminal_total; non_terminal++) {
+			if (non_terminals[non_terminal] == name) return non_terminal;
+		}
+		return none;
+	}
+
+	// get_terminals_and_productions of the generator. Stops at the first error.
+	constexpr bool read_grammar(std::string_view grammar) {
+		bool parsing_terminals = true;
+		size_t line_number = 0;
+		for (size_t line_start = 0; line_start < grammar.size();) {
+			auto line_end = grammar.find('\n', line_start);
+			if (line_end == std::string_view::npos) line_end = grammar.size();
+			auto line = grammar.substr(line_start, line_end - line_start);
+			line_start = line_end + 1;
+			++line_number;
+
+			if (parsing_terminals) {
+				if (line.empty()) {
+					parsing_terminals = false;
+					continue;
+				}
+				if (!is_terminal_name(line)) return fail("Error: Terminal symbols must be declared with a 't_' prefix.", line_number);
+				if (line.size() == 2) return fail("Error: Incomplete terminal symbol declaration.", line_number);
+
+				size_t position = 0;
+				auto name = next_field(line, position);
+				auto second = next_field(line, position);
+				auto third = next_field(line, position);
+				if (!next_field(line, position).empty()) {
+					return fail("Error: Terminal symbol declaration information should not contain more than three fields", line_number);
+				}
+
+				Terminal terminal{ name, 0, 'n' };
+				auto associativity = third.empty() ? second : third;
+				bool has_associativity = !third.empty() || associativity == "n" || associativity == "l" || associativity == "r";
+				if (has_associativity) {
+					if (associativity != "n" && associativity != "l" && associativity != "r") {
+						return fail("Error: Terminal associativity field can only be one of: 'r' (right-associative), 'l' (left-associative), 'n' (non-associative)", line_number);
+					}
+					terminal.associativity = associativity[0];
+				}
+				if (!second.empty() && (!third.empty() || !has_associativity)) {
+					auto parsed = parse_integer(second, terminal.precedence);
+					if (parsed == IntegerField::INVALID) return fail("CaughtException: Invalid non-integer argument to precedence field", line_number);
+					if (parsed == IntegerField::OUT_OF_RANGE) return fail("CaughtException: Argument to precedence field exceeds integer range", line_number);
+				}
+
+				if (find_terminal(name) != none) continue;
+				if (terminal_total == max_terminals) return fail("Error: More terminals than constexpr_tables::max_terminals", line_number);
+				terminals[terminal_total++] = terminal;
+				continue;
+			}
+
+			if (line.empty()) continue;
+			if (is_terminal_name(line)) return fail("Error: Terminal symbols ('t_' prefix) cannot be on the LHS of a production rule", line_number);
+
+			size_t j = 0;
+			while (j < line.size() && !is_whitespace(line[j])) j++;
+			auto lhs = line.substr(0, j);
+			auto non_terminal = find_non_terminal(lhs);
+			if (non_terminal == none) {
+				if (non_terminal_total == max_non_terminals) return fail("Error: More non-terminals than constexpr_tables::max_non_terminals", line_number);
+				non_terminal = static_cast<uint32_t>(non_terminal_total);
+				non_terminals[non_terminal_total++] = lhs;
+			}
+
+			if (line.substr(j, 3) != " > ") return fail("Error: Expected ' > ' delimiter between LHS and RHS of production rule", line_number);
+			auto text = line.substr(j + 3);
+			if (text.empty()) return fail("Error: Grammar production rhs is empty. Ill-defined grammar.", line_number);
+
+			// an explicit precedence for the production ends the RHS
+			int precedence = 0;
+			for (auto i = text.size() - 1; i > 0; i--) {
+				if (!is_whitespace(text[i])) continue;
+				auto symbol = text.substr(i + 1);
+				if (symbol.empty()) continue;
+
+				auto parsed = parse_integer(symbol, precedence);
+				if (parsed == IntegerField::INVALID) break;
+				if (parsed == IntegerField::OUT_OF_RANGE) return fail("CaughtException: Argument to precedence field exceeds integer range", line_number);
+				text = text.substr(0, i);
+				break;
+			}
+
+			if (production_total == max_productions) return fail("Error: More productions than constexpr_tables::max_productions", line_number);
+			auto& production = productions[production_total++];
+			production.text = text;
+			production.line = line_number;
+			production.lhs = non_terminal;
+			production.precedence = precedence;
+		}
+
+		if (terminal_total == 0) return fail("Error: The grammar declares no terminals", line_number);
+		if (production_total == 0) return fail("Error: The grammar has no productions", line_number);
+		return true;
+	}
+
+	// build_production_table and check_symbols_in_productions of the generator: productions by LHS in
+	// declaration order, their symbols, and the 'firsts' of every non-terminal (the leftmost terminal of
+	// the RHS of each of its productions)
+	constexpr bool build_production_table() {
+		for (size_t i = 1; i < production_total; i++) {
+			for (auto j = i; j > 0 && productions[j - 1].lhs > productions[j].lhs; j--) {
+				auto moved = productions[j];
+				productions[j] = productions[j - 1];
+				productions[j - 1] = moved;
+			}
+		}
+
+		for (uint32_t p = 0; p < production_total; p++) {
+			auto& production = productions[p];
+			production.rhs = static_cast<uint32_t>(rhs_total);
+			size_t position = 0;
+			for (auto name = next_field(production.text, position); !name.empty(); name = next_field(production.text, position)) {
+				auto symbol = find_terminal(name);
+				if (symbol == none) {
+					symbol = find_non_terminal(name);
+					if (symbol == none) return fail("Error: Unexpected symbol", production.line);
+					symbol += max_terminals;
+				}
+				else {
+					production.last_terminal_precedence = terminals[symbol].precedence;
+					production.last_terminal_associativity = terminals[symbol].associativity;
+				}
+				if (rhs_total == max_rhs_symbols) return fail("Error: More RHS symbols than constexpr_tables::max_rhs_symbols", production.line);
+				rhs[rhs_total++] = symbol;
+				production.length++;
+			}
+
+			for (uint32_t i = 0; i < production.length; i++) {
+				if (rhs[production.rhs + i] >= max_terminals) continue;
+				firsts[production.lhs] |= uint64_t(1) << rhs[production.rhs + i];
+				break;
+			}
+
+			production.core = static_cast<uint32_t>(core_total);
+			for (uint32_t dot = 0; dot <= production.length; dot++) core_productions[core_total++] = p;
+			lhs_productions[production.lhs + 1] = p + 1;
+
+			for (uint32_t other = 0; other < p; other++) {
+				if (productions[other].length != production.length) continue;
+				bool same = true;
+				for (uint32_t i = 0; i < production.length && same; i++) same = rhs[productions[other].rhs + i] == rhs[production.rhs + i];
+				if (same) return fail("Error: Ill-defined grammar has REDUCE-REDUCE conflict.", production.line);
+			}
+		}
+		return true;
+	}
+
+	// Rules are the distinct (LHS, pop count) pairs of the productions reachable from the goal, numbered
+	// like reduce_info: by LHS in declaration order, then by pop count
+	constexpr void number_rules() {
+		std::array<bool, max_non_terminals> reachable{};
+		std::array<uint32_t, max_non_terminals> queue{};
+		size_t queued = 0;
+		reachable[0] = true;
+		queue[queued++] = 0;
+		for (size_t head = 0; head < queued; head++) {
+			for (auto p = lhs_productions[queue[head]]; p < lhs_productions[queue[head] + 1]; p++) {
+				for (uint32_t i = 0; i < productions[p].length; i++) {
+					auto symbol = rhs[productions[p].rhs + i];
+					if (symbol < max_terminals || reachable[symbol - max_terminals]) continue;
+					reachable[symbol - max_terminals] = true;
+					queue[queued++] = symbol - max_terminals;
+				}
+			}
+		}
+
+		for (uint32_t non_terminal = 0; non_terminal < non_terminal_total; non_terminal++) {
+			if (!reachable[non_terminal]) continue;
+			auto begin = lhs_productions[non_terminal], end = lhs_productions[non_terminal + 1];
+			for (uint32_t length = 1, next_length = 0; length != 0; length = next_length) {
+				next_length = 0;
+				bool found = false;
+				for (auto p = begin; p < end; p++) {
+					auto other = productions[p].length;
+					if (other == length) found = true;
+					else if (other > length && (next_length == 0 || other < next_length)) next_length = other;
+				}
+				if (!found) continue;
+				for (auto p = begin; p < end; p++) {
+					if (productions[p].length == length) productions[p].rule = static_cast<uint32_t>(rule_total);
+				}
+				rule_lhs_symbols[rule_total] = non_terminal;
+				rule_pop_counts[rule_total++] = length;
+			}
+		}
+	}
+
+	// closure_function of the generator over the lookahead masks of every (production, dot): for every
+	// item before a non-terminal C, the productions of C, with the first terminals of what follows C
+	// (or the item's lookaheads) as lookaheads
+	constexpr void close(size_t state, Lookaheads& lookaheads) const {
+		for (size_t core = 0; core < core_total; core++) lookaheads[core] = 0;
+		for (auto item = kernels[state]; item < kernels[state + 1]; item++) lookaheads[kernel_items[item].core] |= kernel_items[item].lookaheads;
+
+		for (bool changed = true; changed;) {
+			changed = false;
+			for (size_t core = 0; core < core_total; core++) {
+				if (!lookaheads[core]) continue;
+				auto& production = productions[core_productions[core]];
+				auto dot = core - production.core;
+				if (dot >= production.length || rhs[production.rhs + dot] < max_terminals) continue;
+				auto non_terminal = rhs[production.rhs + dot] - max_terminals;
+
+				uint64_t following = 0;
+				for (auto i = dot + 1; i < production.length && !following; i++) {
+					auto symbol = rhs[production.rhs + i];
+					following |= symbol < max_terminals ? uint64_t(1) << symbol : firsts[symbol - max_terminals];
+				}
+				if (!following) following = lookaheads[core];
+
+				for (auto p = lhs_productions[non_terminal]; p < lhs_productions[non_terminal + 1]; p++) {
+					auto& closed = lookaheads[productions[p].core];
+					if ((closed | following) == closed) continue;
+					closed |= following;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	// goto_function of the generator: the kernel of the state 'symbol' leads to, sorted by core
+	constexpr size_t move(const Lookaheads& lookaheads, uint32_t symbol, Kernel& kernel) const {
+		size_t size = 0;
+		for (size_t core = 0; core < core_total; core++) {
+			if (!lookaheads[core]) continue;
+			auto& production = productions[core_productions[core]];
+			auto dot = core - production.core;
+			if (dot < production.length && rhs[production.rhs + dot] == symbol) {
+				kernel[size++] = { static_cast<uint32_t>(core + 1), lookaheads[core] };
+			}
+		}
+		return size;
+	}
+
+	// The state of 'kernel', added to the collection if new; 'none' if the collection is full
+	constexpr uint32_t intern(const Kernel& kernel, size_t size) {
+		for (uint32_t state = 0; state < state_total; state++) {
+			if (kernels[state + 1] - kernels[state] != size) continue;
+			bool same = true;
+			for (size_t i = 0; i < size && same; i++) {
+				auto& item = kernel_items[kernels[state] + i];
+				same = item.core == kernel[i].core && item.lookaheads == kernel[i].lookaheads;
+			}
+			if (same) return state;
+		}
+
+		if (state_total == max_states || kernels[state_total] + size > max_kernel_items) return none;
+		for (size_t i = 0; i < size; i++) kernel_items[kernels[state_total] + i] = kernel[i];
+		kernels[state_total + 1] = static_cast<uint32_t>(kernels[state_total] + size);
+		return static_cast<uint32_t>(state_total++);
+	}
+
+	// build_cc and build_tables of the generator, a state at a time. Reductions are taken first: ACCEPT
+	// for the goal on its lookahead, and a REDUCE where the precedence of the reducing production wins
+	// over the lookahead (REDUCE-REDUCE conflicts go to the production declared first); every other
+	// terminal a state moves on is a SHIFT.
+	constexpr bool build_collection() {
+		Kernel kernel{};
+		size_t size = 0;
+		for (auto p = lhs_productions[0]; p < lhs_productions[1]; p++) kernel[size++] = { productions[p].core, uint64_t(1) };
+		intern(kernel, size);
+
+		Lookaheads lookaheads{};
+		for (size_t state = 0; state < state_total; state++) {
+			close(state, lookaheads);
+			auto row = actions.begin() + state * max_terminals;
+			for (size_t terminal = 0; terminal < max_terminals; terminal++) row[terminal] = none;
+
+			uint64_t reduced = 0;
+			for (size_t core = 0; core < core_total; core++) {
+				auto& production = productions[core_productions[core]];
+				if (!lookaheads[core] || core - production.core != production.length) continue;
+				for (uint32_t terminal = 0; terminal < terminal_total; terminal++) {
+					if (!(lookaheads[core] >> terminal & 1)) continue;
+					if (production.lhs == 0 && terminal == 0) {
+						row[terminal] = static_cast<uint32_t>(binary_tables::ACCEPT) << binary_tables::kind_shift;
+						continue;
+					}
+
+					auto terminal_precedence = terminals[terminal].precedence;
+					bool reduce = production.precedence > terminal_precedence || production.last_terminal_precedence == 0 ||
+						production.last_terminal_precedence > terminal_precedence ||
+						(production.last_terminal_precedence == terminal_precedence && production.last_terminal_associativity == 'l');
+					if (reduce && !(reduced >> terminal & 1)) {
+						reduced |= uint64_t(1) << terminal;
+						row[terminal] = static_cast<uint32_t>(binary_tables::REDUCE) << binary_tables::kind_shift | production.rule;
+					}
+				}
+			}
+
+			for (uint32_t terminal = 0; terminal < terminal_total; terminal++) {
+				if (row[terminal] != none) continue;
+				size = move(lookaheads, terminal, kernel);
+				if (!size) continue;
+				auto next_state = intern(kernel, size);
+				if (next_state == none) return fail("Error: More states than constexpr_tables::max_states (or kernel items than max_kernel_items)", productions[0].line);
+				row[terminal] = static_cast<uint32_t>(binary_tables::SHIFT) << binary_tables::kind_shift | next_state;
+			}
+
+			for (uint32_t non_terminal = 0; non_terminal < non_terminal_total; non_terminal++) {
+				auto& entry = gotos[state * max_non_terminals + non_terminal];
+				entry = none;
+				size = move(lookaheads, max_terminals + non_terminal, kernel);
+				if (!size) continue;
+				entry = intern(kernel, size);
+				if (entry == none) return fail("Error: More states than constexpr_tables::max_states (or kernel items than max_kernel_items)", productions[0].line);
+			}
+		}
+		return true;
+	}
+
+public:
+	constexpr explicit Builder(std::string_view grammar) {
+		if (read_grammar(grammar) && build_production_table()) {
+			number_rules();
+			build_collection();
+		}
+	}
+
+	// The first error in the grammar, and its line (from 1); nullptr and 0 if there is none
+	constexpr const char* error() const { return error_message; }
+	constexpr size_t error_line() const { return error_line_number; }
+
+	constexpr size_t terminal_count() const { return error_message ? 0 : terminal_total; }
+	constexpr size_t non_terminal_count() const { return error_message ? 0 : non_terminal_total; }
+	constexpr size_t rule_count() const { return error_message ? 0 : rule_total; }
+	constexpr size_t state_count() const { return error_message ? 0 : state_total; }
+
+	constexpr std::string_view terminal_name(size_t terminal) const { return terminals[terminal].name; }
+	constexpr std::string_view non_terminal_name(size_t non_terminal) const { return non_terminals[non_terminal]; }
+	constexpr uint32_t rule_lhs(size_t rule) const { return rule_lhs_symbols[rule]; }
+	constexpr uint32_t rule_pop_count(size_t rule) const { return rule_pop_counts[rule]; }
+
+	// The packed action entry (ActionKind in the top 2 bits, as in binary-tables.h), or 'none'
+	constexpr uint32_t action(size_t state, size_t terminal) const { return actions[state * max_terminals + terminal]; }
+	constexpr uint32_t goto_state(size_t state, size_t non_terminal) const { return gotos[state * max_non_terminals + non_terminal]; }
+};
+
+// The tables Builder built, in arrays of their exact size. Lookups and parse() are constexpr.
+template<size_t Terminals, size_t NonTerminals, size_t States, size_t Rules>
+class Tables {
+	std::array<std::string_view, Terminals + NonTerminals> names{};
+	std::array<uint32_t, States * Terminals> actions{};
+	std::array<uint32_t, States * NonTerminals> gotos{};
+	std::array<uint32_t, Rules> lhs{}, pop_counts{};
+
+public:
+	constexpr explicit Tables(const Builder& built) {
+		for (size_t terminal = 0; terminal < Terminals; terminal++) names[terminal] = built.terminal_name(terminal);
+		for (size_t non_terminal = 0; non_terminal < NonTerminals; non_terminal++) names[Terminals + non_terminal] = built.non_terminal_name(non_terminal);
+		for (size_t state = 0; state < States; state++) {
+			for (size_t terminal = 0; terminal < Terminals; terminal++) actions[state * Terminals + terminal] = built.action(state, terminal);
+			for (size_t non_terminal = 0; non_terminal < NonTerminals; non_terminal++) gotos[state * NonTerminals + non_terminal] = built.goto_state(state, non_terminal);
+		}
+		for (size_t rule = 0; rule < Rules; rule++) {
+			lhs[rule] = built.rule_lhs(rule);
+			pop_counts[rule] = built.rule_pop_count(rule);
+		}
+	}
+
+	static constexpr uint32_t state_count() { return States; }
+	static constexpr uint32_t terminal_count() { return Terminals; }
+	static constexpr uint32_t non_terminal_count() { return NonTerminals; }
+	static constexpr uint32_t rule_count() { return Rules; }
+
+	constexpr std::string_view terminal_name(uint32_t terminal) const { return names[terminal]; }
+	constexpr std::string_view non_terminal_name(uint32_t non_terminal) const { return names[Terminals + non_terminal]; }
+
+	// The index of a terminal or non-terminal, or 'none'
+	constexpr uint32_t terminal(std::string_view name) const {
+		for (uint32_t terminal = 0; terminal < Terminals; terminal++) {
+			if (names[terminal] == name) return terminal;
+		}
+		return none;
+	}
+
+	constexpr uint32_t non_terminal(std::string_view name) const {
+		for (uint32_t non_terminal = 0; non_terminal < NonTerminals; non_terminal++) {
+			if (names[Terminals + non_terminal] == name) return non_terminal;
+		}
+		return none;
+	}
+
+	constexpr uint32_t rule_lhs(uint32_t rule) const { return lhs[rule]; }
+	constexpr uint32_t rule_pop_count(uint32_t rule) const { return pop_counts[rule]; }
+
+	constexpr bool action(uint32_t state, uint32_t terminal, Action& out) const {
+		auto value = actions[state * Terminals + terminal];
+		if (value == none) return false;
+		out = { static_cast<ActionKind>(value >> binary_tables::kind_shift), value & binary_tables::value_mask };
+		return true;
+	}
+
+	constexpr bool goto_state(uint32_t state, uint32_t non_terminal, uint32_t& out) const {
+		auto value = gotos[state * NonTerminals + non_terminal];
+		if (value == none) return false;
+		out = value;
+		return true;
+	}
+
+	// Tables::parse() of binary-tables.h, usable in constant expressions (with constexpr callbacks). The
+	// state stack is 'states' as it is, any array of uint32_t: a parse never holds more than 'count' + 1
+	// states, and rejects an input that would need more than states.size().
+	template<typename Symbol, typename Stack, typename OnShift, typename OnReduce>
+	constexpr bool parse(const Symbol* tokens, size_t count, Stack& states, OnShift&& on_shift, OnReduce&& on_reduce) const {
+		if (states.size() == 0) return false;
+		states[0] = 0;
+		size_t depth = 1;
+
+		for (size_t i = 0; i < count;) {
+			Action next{ binary_tables::SHIFT, 0 };
+			auto terminal = static_cast<uint32_t>(tokens[i]);
+			if (terminal >= Terminals || !action(states[depth - 1], terminal, next)) return false;
+			if (next.kind == binary_tables::ACCEPT) return true;
+			if (next.kind == binary_tables::SHIFT) {
+				if (depth == states.size()) return false;
+				on_shift(i);
+				++i;
+				states[depth++] = next.value;
+				continue;
+			}
+
+			auto rule = next.value;
+			if (pop_counts[rule] >= depth) return false;
+			depth -= pop_counts[rule];
+			uint32_t next_state = 0;
+			if (!goto_state(states[depth - 1], lhs[rule], next_state)) return false;
+			states[depth++] = next_state;
+			on_reduce(rule);
+		}
+		return false;
+	}
+};
+
+// Builder's result for 'grammar', a character array or std::string_view of static storage duration.
+// Only ever evaluated by the compiler.
+template<const auto& grammar>
+inline constexpr Builder built{ std::string_view(grammar) };
+
+template<const auto& grammar>
+constexpr auto make_tables() {
+	constexpr auto& grammar_built = built<grammar>;
+	static_assert(grammar_built.error_line() == 0, "constexpr_tables: error in the grammar, at the line the comparison reduces to");
+	return Tables<grammar_built.terminal_count(), grammar_built.non_terminal_count(), grammar_built.state_count(),
+		grammar_built.rule_count()>(grammar_built);
+}
+
+template<const auto& grammar>
+inline constexpr auto tables = make_tables<grammar>();
+
+} // namespace constexpr_tables
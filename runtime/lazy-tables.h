@@ -0,0 +1,656 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "binary-tables.h"
+
+// LR(1) parse tables built at parse time, for grammars whose inputs only ever reach a fraction of
+// their states. 'parsegen --emit-lazy' writes the checked grammar as a blob instead of tables, and
+// this runtime builds the canonical collection from it on demand: a state's action and goto rows are
+// built the first time a parse reaches the state, the way build_cc and build_tables would build them,
+// so generation takes no time and memory grows with the states the inputs actually use.
+//
+// Layout of the grammar blob. Integers, offsets and the checksum are as in binary-tables.h:
+//
+//   header               the fields of HeaderField
+//   names                (terminal_count + non_terminal_count) x { offset, length } of the symbol names,
+//                        terminals first (in TokenType order), then non-terminals
+//   terminals            terminal_count x precedence
+//   rules                rule_count x { lhs (non-terminal index), pop count }, numbered like reduce_info
+//   productions          production_count x the fields of ProductionField
+//   rhs                  rhs_size x symbol: a terminal index, or terminal_count + a non-terminal index
+//   firsts               (non_terminal_count + 1) x offset into the first terminals, then first_size x
+//                        terminal: the terminals closures take as lookaheads after each non-terminal
+//   symbol name bytes
+//
+// Rows are memoized as they are built. Looking up a built row takes no lock, and building one takes
+// a mutex, so one Tables can serve parses on any number of threads. save() writes the states built so
+// far to a file and load() reads them back, so a process can start warm, with the rows an earlier run
+// (or warm_up() over a sample of inputs) built.
+
+namespace lazy_tables {
+
+constexpr char magic[4] = { 'P', 'G', 'L', 'G' };
+constexpr char cache_magic[4] = { 'P', 'G', 'L', 'C' };
+constexpr uint32_t version = 1;
+constexpr uint32_t none = binary_tables::none;
+
+// Byte offsets of the header fields
+enum HeaderField : uint32_t {
+	MAGIC = 0,
+	VERSION = 4,
+	SIZE = 8,
+	CHECKSUM = 12,
+	TERMINAL_COUNT = 16,
+	NON_TERMINAL_COUNT = 20,
+	RULE_COUNT = 24,
+	PRODUCTION_COUNT = 28,
+	RHS_SIZE = 32,
+	FIRST_SIZE = 36,
+	GOAL = 40,
+	LOOKAHEAD = 44,
+	NAMES = 48,
+	TERMINALS = 52,
+	RULES = 56,
+	PRODUCTIONS = 60,
+	RHS = 64,
+	FIRSTS = 68,
+	HEADER_SIZE = 72
+};
+
+// Word offsets of the fields of a production. The last terminal of the RHS decides SHIFT-REDUCE
+// conflicts on the production, along with its precedence.
+enum ProductionField : uint32_t {
+	LHS,
+	RHS_OFFSET,
+	RHS_LENGTH,
+	RULE,
+	PRECEDENCE,
+	LAST_TERMINAL_PRECEDENCE,
+	LAST_TERMINAL_ASSOCIATIVITY,
+	PRODUCTION_FIELDS
+};
+
+using binary_tables::Action;
+using binary_tables::ActionKind;
+
+class Tables {
+	struct Production {
+		uint32_t lhs, rhs, length, rule;
+		int32_t precedence, last_terminal_precedence;
+		char last_terminal_associativity;
+	};
+
+	// An LR(1) item: 'dot' symbols of the production's RHS have been seen
+	struct Item {
+		uint32_t production, dot, lookahead;
+
+		bool operator==(const Item& other) const {
+			return production == other.production && dot == other.dot && lookahead == other.lookahead;
+		}
+
+		bool operator<(const Item& other) const {
+			if (production != other.production) return production < other.production;
+			if (dot != other.dot) return dot < other.dot;
+			return lookahead < other.lookahead;
+		}
+	};
+
+	// The kernel items of a state, sorted: they identify it
+	using Kernel = std::vector<Item>;
+
+	struct ItemHash {
+		size_t operator()(const Item& item) const {
+			auto key = (static_cast<uint64_t>(item.production) << 32 | item.dot) * 0x9e3779b97f4a7c15;
+			return static_cast<size_t>(key ^ (key >> 29) ^ item.lookahead * 0xc2b2ae3d27d4eb4f);
+		}
+
+		size_t operator()(const Kernel& kernel) const {
+			uint64_t key = kernel.size();
+			for (auto& item : kernel) key = (key ^ operator()(item)) * 0x100000001b3;
+			return static_cast<size_t>(key);
+		}
+	};
+
+	// The built entries of a state, sorted by symbol. Action values hold the ActionKind in their top
+	// 2 bits and the SHIFT target state or REDUCE rule below, as in binary-tables.h.
+	struct Row {
+		std::vector<std::pair<uint32_t, uint32_t>> actions;
+		std::vector<std::pair<uint32_t, uint32_t>> gotos;
+	};
+
+	// Rows are found through a two-level directory of atomic pointers, so readers never lock: a chunk
+	// is published before any state in it is, and a row before the state's entry points to it.
+	static constexpr uint32_t chunk_bits = 12;
+	static constexpr uint32_t chunk_size = 1u << chunk_bits;
+	static constexpr uint32_t chunk_mask = chunk_size - 1;
+	static constexpr uint32_t max_chunks = 4096;
+	using Chunk = std::atomic<const Row*>;
+
+	// the grammar, decoded by attach()
+	std::vector<unsigned char> blob;
+	uint32_t terminals = 0, non_terminals = 0, goal = 0, lookahead = 0;
+	std::vector<std::string_view> names;
+	std::vector<int32_t> terminal_precedences;
+	std::vector<std::pair<uint32_t, uint32_t>> rules;
+	std::vector<Production> productions;
+	std::vector<uint32_t> rhs;
+	std::vector<uint32_t> first_offsets, first_terminals;
+	std::vector<uint32_t> lhs_offsets, lhs_productions; // productions of every non-terminal
+
+	// the states found so far; built rows are only ever added, under 'mutex'
+	mutable std::mutex mutex;
+	std::vector<Kernel> kernels;
+	std::unordered_map<Kernel, uint32_t, ItemHash> kernel_states;
+	std::deque<Row> built_rows;
+	std::vector<std::unique_ptr<Chunk[]>> chunks;
+	std::unique_ptr<std::atomic<Chunk*>[]> directory{ new std::atomic<Chunk*>[max_chunks] };
+	std::atomic<uint32_t> states{ 0 };
+	std::atomic<uint32_t> built_states{ 0 };
+
+	static uint32_t load_word(const unsigned char* at) {
+		uint32_t value;
+		std::memcpy(&value, at, sizeof(value));
+		return value;
+	}
+
+	static void append_word(std::string& out, size_t value) {
+		auto word = static_cast<uint32_t>(value);
+		out.append(reinterpret_cast<const char*>(&word), sizeof(word));
+	}
+
+	uint32_t field(uint32_t offset) const {
+		return load_word(blob.data() + offset);
+	}
+
+	// 'count' u32s at 'offset' fit in the blob
+	bool section_fits(uint32_t offset, uint64_t count) const {
+		return offset >= HEADER_SIZE && offset % 4 == 0 && offset + count * 4 <= blob.size();
+	}
+
+	bool is_terminal(uint32_t symbol) const {
+		return symbol < terminals;
+	}
+
+	// Forget the grammar. Called with 'mutex' held.
+	void clear_grammar() {
+		blob.clear();
+		terminals = non_terminals = goal = lookahead = 0;
+		names.clear();
+		terminal_precedences.clear();
+		rules.clear();
+		productions.clear();
+		rhs.clear();
+		first_offsets.clear();
+		first_terminals.clear();
+		lhs_offsets.clear();
+		lhs_productions.clear();
+	}
+
+	// Forget every state. Called with 'mutex' held.
+	void clear_states() {
+		for (uint32_t chunk = 0; chunk < max_chunks; chunk++) directory[chunk].store(nullptr, std::memory_order_relaxed);
+		chunks.clear();
+		kernels.clear();
+		kernel_states.clear();
+		built_rows.clear();
+		states.store(0);
+		built_states.store(0);
+	}
+
+	// State 0: the goal productions, before their first symbol. Called with 'mutex' held.
+	void add_start_state() {
+		Kernel start;
+		for (auto index = lhs_offsets[goal]; index < lhs_offsets[goal + 1]; index++) start.push_back({ lhs_productions[index], 0, lookahead });
+		intern(std::move(start));
+	}
+
+	bool decode(std::string& error) {
+		if (blob.size() < HEADER_SIZE || std::memcmp(blob.data(), magic, sizeof(magic)) != 0) return error = "not a lazy grammar blob", false;
+		if (field(VERSION) != version) return error = "unsupported version " + std::to_string(field(VERSION)), false;
+		if (field(SIZE) != blob.size()) return error = "truncated blob", false;
+		if (binary_tables::crc32(blob.data() + CHECKSUM + 4, blob.size() - CHECKSUM - 4) != field(CHECKSUM)) return error = "checksum mismatch", false;
+
+		terminals = field(TERMINAL_COUNT);
+		non_terminals = field(NON_TERMINAL_COUNT);
+		auto rule_count = field(RULE_COUNT), production_count = field(PRODUCTION_COUNT);
+		auto rhs_size = field(RHS_SIZE), first_size = field(FIRST_SIZE);
+		goal = field(GOAL);
+		lookahead = field(LOOKAHEAD);
+		if (!section_fits(field(NAMES), (static_cast<uint64_t>(terminals) + non_terminals) * 2) ||
+			!section_fits(field(TERMINALS), terminals) || !section_fits(field(RULES), static_cast<uint64_t>(rule_count) * 2) ||
+			!section_fits(field(PRODUCTIONS), static_cast<uint64_t>(production_count) * PRODUCTION_FIELDS) ||
+			!section_fits(field(RHS), rhs_size) || !section_fits(field(FIRSTS), static_cast<uint64_t>(non_terminals) + 1 + first_size))
+		{
+			return error = "section out of bounds", false;
+		}
+		if (goal >= non_terminals || lookahead >= terminals) return error = "invalid goal", false;
+
+		auto symbols = terminals + non_terminals;
+		for (uint32_t symbol = 0; symbol < symbols; symbol++) {
+			auto at = blob.data() + field(NAMES) + symbol * 8;
+			auto offset = load_word(at), length = load_word(at + 4);
+			if (static_cast<uint64_t>(offset) + length > blob.size()) return error = "symbol name out of bounds", false;
+			names.emplace_back(reinterpret_cast<const char*>(blob.data()) + offset, length);
+		}
+		for (uint32_t terminal = 0; terminal < terminals; terminal++) {
+			terminal_precedences.push_back(static_cast<int32_t>(load_word(blob.data() + field(TERMINALS) + terminal * 4)));
+		}
+		for (uint32_t rule = 0; rule < rule_count; rule++) {
+			auto at = blob.data() + field(RULES) + rule * 8;
+			rules.emplace_back(load_word(at), load_word(at + 4));
+			if (rules.back().first >= non_terminals) return error = "rule with an invalid LHS", false;
+		}
+		for (uint32_t symbol = 0; symbol < rhs_size; symbol++) {
+			rhs.push_back(load_word(blob.data() + field(RHS) + symbol * 4));
+			if (rhs.back() >= symbols) return error = "invalid production symbol", false;
+		}
+		for (uint32_t production = 0; production < production_count; production++) {
+			auto at = blob.data() + field(PRODUCTIONS) + production * PRODUCTION_FIELDS * 4;
+			auto word = [at](uint32_t production_field) { return load_word(at + production_field * 4); };
+			productions.push_back({ word(LHS), word(RHS_OFFSET), word(RHS_LENGTH), word(RULE), static_cast<int32_t>(word(PRECEDENCE)),
+				static_cast<int32_t>(word(LAST_TERMINAL_PRECEDENCE)), static_cast<char>(word(LAST_TERMINAL_ASSOCIATIVITY)) });
+			auto& added = productions.back();
+			if (added.lhs >= non_terminals || added.rule >= rule_count || static_cast<uint64_t>(added.rhs) + added.length > rhs_size) {
+				return error = "invalid production", false;
+			}
+		}
+		for (uint32_t index = 0; index < non_terminals + 1 + first_size; index++) {
+			auto value = load_word(blob.data() + field(FIRSTS) + index * 4);
+			if (index <= non_terminals) first_offsets.push_back(value);
+			else first_terminals.push_back(value);
+		}
+		for (uint32_t non_terminal = 0; non_terminal < non_terminals; non_terminal++) {
+			if (first_offsets[non_terminal] > first_offsets[non_terminal + 1] || first_offsets[non_terminal + 1] > first_size) {
+				return error = "invalid first terminals", false;
+			}
+		}
+		for (auto terminal : first_terminals) {
+			if (terminal >= terminals) return error = "invalid first terminals", false;
+		}
+
+		lhs_offsets.assign(non_terminals + 1, 0);
+		for (auto& production : productions) ++lhs_offsets[production.lhs + 1];
+		for (uint32_t non_terminal = 0; non_terminal < non_terminals; non_terminal++) lhs_offsets[non_terminal + 1] += lhs_offsets[non_terminal];
+		lhs_productions.resize(productions.size());
+		auto next = lhs_offsets;
+		for (uint32_t production = 0; production < productions.size(); production++) lhs_productions[next[productions[production].lhs]++] = production;
+		if (lhs_offsets[goal] == lhs_offsets[goal + 1]) return error = "the goal has no productions", false;
+		return true;
+	}
+
+	// The state of 'kernel', added if it is new. Called with 'mutex' held. Returns 'none' once the
+	// directory is full.
+	uint32_t intern(Kernel&& kernel) {
+		auto found = kernel_states.find(kernel);
+		if (found != kernel_states.end()) return found->second;
+
+		auto state = static_cast<uint32_t>(kernels.size());
+		if (state >= chunk_size * max_chunks) return none;
+		if (state % chunk_size == 0) {
+			chunks.emplace_back(new Chunk[chunk_size]);
+			for (uint32_t row = 0; row < chunk_size; row++) chunks.back()[row].store(nullptr, std::memory_order_relaxed);
+			directory[state >> chunk_bits].store(chunks.back().get(), std::memory_order_release);
+		}
+		kernel_states.emplace(kernel, state);
+		kernels.push_back(std::move(kernel));
+		states.store(state + 1, std::memory_order_release);
+		return state;
+	}
+
+	// closure_function of the generator: for every item before a non-terminal C, the productions of C,
+	// with the first terminals of what follows C (or the item's lookahead) as lookaheads
+	std::vector<Item> closure(const Kernel& kernel) const {
+		std::vector<Item> items(kernel);
+		std::unordered_set<Item, ItemHash> added(kernel.begin(), kernel.end());
+		std::vector<uint32_t> lookaheads;
+		for (size_t next = 0; next < items.size(); next++) {
+			auto item = items[next];
+			auto& production = productions[item.production];
+			if (item.dot >= production.length || is_terminal(rhs[production.rhs + item.dot])) continue;
+			auto non_terminal = rhs[production.rhs + item.dot] - terminals;
+
+			lookaheads.clear();
+			for (auto symbol = item.dot + 1; symbol < production.length; symbol++) {
+				auto following = rhs[production.rhs + symbol];
+				if (is_terminal(following)) {
+					lookaheads.push_back(following);
+					break;
+				}
+				following -= terminals;
+				lookaheads.insert(lookaheads.end(), first_terminals.begin() + first_offsets[following], first_terminals.begin() + first_offsets[following + 1]);
+				if (!lookaheads.empty()) break;
+			}
+			if (lookaheads.empty()) lookaheads.push_back(item.lookahead);
+
+			for (auto index = lhs_offsets[non_terminal]; index < lhs_offsets[non_terminal + 1]; index++) {
+				for (auto terminal : lookaheads) {
+					Item closed{ lhs_productions[index], 0, terminal };
+					if (added.insert(closed).second) items.push_back(closed);
+				}
+			}
+		}
+		return items;
+	}
+
+	// Build the row of 'state' (build_tables of the generator), adding the states it leads to.
+	// SHIFT-REDUCE conflicts are decided by the precedence of the reducing production, and
+	// REDUCE-REDUCE conflicts in favor of the production declared first.
+	const Row& build_row(uint32_t state) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto built = directory[state >> chunk_bits].load(std::memory_order_relaxed)[state & chunk_mask].load(std::memory_order_relaxed);
+		if (built) return *built;
+
+		auto items = closure(kernels[state]);
+		std::map<uint32_t, Kernel> successors;
+		for (auto& item : items) {
+			auto& production = productions[item.production];
+			if (item.dot < production.length) successors[rhs[production.rhs + item.dot]].push_back({ item.production, item.dot + 1, item.lookahead });
+		}
+
+		Row row;
+		std::map<uint32_t, uint32_t> actions;
+		for (auto& successor : successors) {
+			std::sort(successor.second.begin(), successor.second.end());
+			auto next_state = intern(std::move(successor.second));
+			if (next_state == none) continue;
+			if (is_terminal(successor.first)) actions[successor.first] = static_cast<uint32_t>(binary_tables::SHIFT) << binary_tables::kind_shift | next_state;
+			else row.gotos.emplace_back(successor.first - terminals, next_state);
+		}
+
+		std::sort(items.begin(), items.end());
+		std::unordered_set<uint32_t> reduced;
+		for (auto& item : items) {
+			auto& production = productions[item.production];
+			if (item.dot < production.length) continue;
+			if (production.lhs == goal && item.lookahead == lookahead) {
+				actions[item.lookahead] = static_cast<uint32_t>(binary_tables::ACCEPT) << binary_tables::kind_shift;
+				continue;
+			}
+
+			auto terminal_precedence = terminal_precedences[item.lookahead];
+			bool reduce = production.precedence > terminal_precedence || production.last_terminal_precedence == 0 ||
+				production.last_terminal_precedence > terminal_precedence ||
+				(production.last_terminal_precedence == terminal_precedence && production.last_terminal_associativity == 'l');
+			if (reduce && reduced.insert(item.lookahead).second) {
+				actions[item.lookahead] = static_cast<uint32_t>(binary_tables::REDUCE) << binary_tables::kind_shift | production.rule;
+			}
+		}
+		row.actions.assign(actions.begin(), actions.end());
+
+		built_rows.push_back(std::move(row));
+		publish(state, &built_rows.back());
+		return built_rows.back();
+	}
+
+	void publish(uint32_t state, const Row* row) {
+		directory[state >> chunk_bits].load(std::memory_order_relaxed)[state & chunk_mask].store(row, std::memory_order_release);
+		built_states.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	const Row& row(uint32_t state) {
+		auto chunk = directory[state >> chunk_bits].load(std::memory_order_acquire);
+		auto built = chunk[state & chunk_mask].load(std::memory_order_acquire);
+		return built ? *built : build_row(state);
+	}
+
+	static bool find(const std::vector<std::pair<uint32_t, uint32_t>>& entries, uint32_t symbol, uint32_t& value) {
+		auto found = std::lower_bound(entries.begin(), entries.end(), std::make_pair(symbol, uint32_t(0)));
+		if (found == entries.end() || found->first != symbol) return false;
+		value = found->second;
+		return true;
+	}
+
+public:
+	Tables() {
+		for (uint32_t chunk = 0; chunk < max_chunks; chunk++) directory[chunk].store(nullptr, std::memory_order_relaxed);
+	}
+	Tables(const Tables&) = delete;
+	Tables& operator=(const Tables&) = delete;
+
+	// Read the grammar blob at 'path', forgetting any states of an earlier grammar. Must not run while
+	// parses do. On failure, 'error' says why.
+	bool open(const std::string& path, std::string& error) {
+		std::ifstream file(path, std::ios::in | std::ios::binary);
+		if (!file.is_open()) return error = "unable to open " + path, false;
+		std::vector<unsigned char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		return attach(contents.data(), contents.size(), error);
+	}
+
+	// Use a grammar blob held in memory (e.g. embedded in the executable); it is copied.
+	bool attach(const void* grammar, size_t size, std::string& error) {
+		std::lock_guard<std::mutex> lock(mutex);
+		clear_grammar();
+		clear_states();
+		auto bytes = static_cast<const unsigned char*>(grammar);
+		blob.assign(bytes, bytes + size);
+		if (!decode(error)) {
+			clear_grammar();
+			return false;
+		}
+		add_start_state();
+		return true;
+	}
+
+	// States found so far, and those of them whose rows are built
+	uint32_t state_count() const { return states.load(std::memory_order_acquire); }
+	uint32_t built_state_count() const { return built_states.load(std::memory_order_relaxed); }
+
+	uint32_t terminal_count() const { return terminals; }
+	uint32_t non_terminal_count() const { return non_terminals; }
+	uint32_t rule_count() const { return static_cast<uint32_t>(rules.size()); }
+
+	std::string_view terminal_name(uint32_t terminal) const { return names[terminal]; }
+	std::string_view non_terminal_name(uint32_t non_terminal) const { return names[terminals + non_terminal]; }
+
+	// Index of a terminal (its TokenType value), or 'none'. A linear search, meant for mapping a
+	// scanner's tokens once, at startup.
+	uint32_t terminal(std::string_view name) const {
+		for (uint32_t terminal = 0; terminal < terminals; terminal++) {
+			if (names[terminal] == name) return terminal;
+		}
+		return none;
+	}
+
+	uint32_t non_terminal(std::string_view name) const {
+		for (uint32_t non_terminal = 0; non_terminal < non_terminals; non_terminal++) {
+			if (names[terminals + non_terminal] == name) return non_terminal;
+		}
+		return none;
+	}
+
+	// reduce_info[rule].first, as a non-terminal index
+	uint32_t rule_lhs(uint32_t rule) const { return rules[rule].first; }
+
+	// reduce_info[rule].second
+	uint32_t rule_pop_count(uint32_t rule) const { return rules[rule].second; }
+
+	// The action of 'state' on 'terminal', building the state's row if it is not built yet
+	bool action(uint32_t state, uint32_t terminal, Action& out) {
+		uint32_t value;
+		if (state >= state_count() || !find(row(state).actions, terminal, value)) return false;
+		out = { static_cast<ActionKind>(value >> binary_tables::kind_shift), value & binary_tables::value_mask };
+		return true;
+	}
+
+	bool goto_state(uint32_t state, uint32_t non_terminal, uint32_t& next) {
+		return state < state_count() && find(row(state).gotos, non_terminal, next);
+	}
+
+	// Parse 'tokens' (terminal indices, ending with the goal lookahead terminal), with 'states' as the
+	// state stack, like binary_tables::Tables::parse. Returns false on a syntax error.
+	template<typename OnShift, typename OnReduce>
+	bool parse(const uint32_t* tokens, size_t count, std::vector<uint32_t>& states, OnShift&& on_shift, OnReduce&& on_reduce) {
+		states.clear();
+		if (productions.empty()) return false;
+		states.push_back(0);
+
+		for (size_t i = 0; i < count;) {
+			uint32_t value;
+			if (tokens[i] >= terminals || !find(row(states.back()).actions, tokens[i], value)) return false;
+
+			auto kind = value >> binary_tables::kind_shift;
+			if (kind == binary_tables::ACCEPT) return true;
+			if (kind == binary_tables::SHIFT) {
+				on_shift(i);
+				++i;
+				states.push_back(value & binary_tables::value_mask);
+				continue;
+			}
+
+			auto rule = value & binary_tables::value_mask;
+			auto pop_count = rule_pop_count(rule);
+			if (pop_count >= states.size()) return false;
+			states.resize(states.size() - pop_count);
+			uint32_t next_state;
+			if (!find(row(states.back()).gotos, rule_lhs(rule), next_state)) return false;
+			states.push_back(next_state);
+			on_reduce(rule);
+		}
+		return false;
+	}
+
+	// Build the rows parsing 'tokens' needs, ahead of the parses that will need them
+	bool warm_up(const uint32_t* tokens, size_t count) {
+		std::vector<uint32_t> stack;
+		return parse(tokens, count, stack, [](size_t) {}, [](uint32_t) {});
+	}
+
+	// Write the states found so far, and the rows built, to 'path'. Parses may run meanwhile.
+	//
+	// Layout (u32s): magic, version, size, checksum of the rest, the grammar blob's checksum, state
+	// count, then for every state: kernel size, built flag, the kernel's { production, dot, lookahead }
+	// items and, if built, action count, goto count and the row's { symbol, value } entries.
+	bool save(const std::string& path, std::string& error) const {
+		std::string out(16, '\0');
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (blob.empty()) return error = "no grammar", false;
+			append_word(out, field(CHECKSUM));
+			append_word(out, kernels.size());
+			for (uint32_t state = 0; state < kernels.size(); state++) {
+				auto built = directory[state >> chunk_bits].load(std::memory_order_relaxed)[state & chunk_mask].load(std::memory_order_relaxed);
+				append_word(out, kernels[state].size());
+				append_word(out, built != nullptr);
+				for (auto& item : kernels[state]) {
+					append_word(out, item.production);
+					append_word(out, item.dot);
+					append_word(out, item.lookahead);
+				}
+				if (!built) continue;
+				append_word(out, built->actions.size());
+				append_word(out, built->gotos.size());
+				for (auto& entry : built->actions) {
+					append_word(out, entry.first);
+					append_word(out, entry.second);
+				}
+				for (auto& entry : built->gotos) {
+					append_word(out, entry.first);
+					append_word(out, entry.second);
+				}
+			}
+		}
+
+		std::memcpy(&out[0], cache_magic, sizeof(cache_magic));
+		auto header_word = [&out](size_t offset, size_t value) {
+			auto word = static_cast<uint32_t>(value);
+			std::memcpy(&out[offset], &word, sizeof(word));
+		};
+		header_word(4, version);
+		header_word(8, out.size());
+		header_word(12, binary_tables::crc32(reinterpret_cast<const unsigned char*>(out.data()) + 16, out.size() - 16));
+
+		std::ofstream file(path, std::ios::out | std::ios::binary);
+		if (!file.is_open() || !file.write(out.data(), static_cast<std::streamsize>(out.size()))) return error = "unable to write " + path, false;
+		return true;
+	}
+
+	// Replace the states with those saved at 'path' for the same grammar. Must not run while parses do.
+	// On failure, the states are left as they were and 'error' says why.
+	bool load(const std::string& path, std::string& error) {
+		std::ifstream file(path, std::ios::in | std::ios::binary);
+		if (!file.is_open()) return error = "unable to open " + path, false;
+		std::vector<unsigned char> in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (blob.empty()) return error = "no grammar", false;
+		if (in.size() < 24 || in.size() % 4 != 0 || std::memcmp(in.data(), cache_magic, sizeof(cache_magic)) != 0) return error = "not a state cache", false;
+		if (load_word(in.data() + 4) != version) return error = "unsupported version " + std::to_string(load_word(in.data() + 4)), false;
+		if (load_word(in.data() + 8) != in.size()) return error = "truncated state cache", false;
+		if (binary_tables::crc32(in.data() + 16, in.size() - 16) != load_word(in.data() + 12)) return error = "checksum mismatch", false;
+		if (load_word(in.data() + 16) != field(CHECKSUM)) return error = "saved for another grammar", false;
+
+		size_t position = 24;
+		auto next = [&in, &position](uint32_t& value) {
+			if (position + 4 > in.size()) return false;
+			value = load_word(in.data() + position);
+			position += 4;
+			return true;
+		};
+
+		auto state_total = load_word(in.data() + 20);
+		if (state_total == 0 || state_total > chunk_size * max_chunks) return error = "invalid state count", false;
+		std::vector<Kernel> saved_kernels(state_total);
+		std::vector<std::unique_ptr<Row>> saved_rows(state_total);
+		for (auto& kernel : saved_kernels) {
+			uint32_t size, built;
+			if (!next(size) || !next(built) || size > (in.size() - position) / 12) return error = "truncated state cache", false;
+			for (uint32_t index = 0; index < size; index++) {
+				Item item;
+				if (!next(item.production) || !next(item.dot) || !next(item.lookahead)) return error = "truncated state cache", false;
+				if (item.production >= productions.size() || item.dot > productions[item.production].length || item.lookahead >= terminals ||
+					(!kernel.empty() && !(kernel.back() < item)))
+				{
+					return error = "invalid state", false;
+				}
+				kernel.push_back(item);
+			}
+			if (!built) continue;
+
+			uint32_t action_count, goto_count;
+			if (!next(action_count) || !next(goto_count) || action_count > (in.size() - position) / 8) return error = "truncated state cache", false;
+			auto row = std::make_unique<Row>();
+			for (uint32_t index = 0; index < action_count + goto_count; index++) {
+				uint32_t symbol, value;
+				if (!next(symbol) || !next(value)) return error = "truncated state cache", false;
+				auto kind = value >> binary_tables::kind_shift;
+				bool valid = index < action_count ?
+					symbol < terminals && (kind == binary_tables::ACCEPT || (kind == binary_tables::SHIFT && (value & binary_tables::value_mask) < state_total) ||
+						(kind == binary_tables::REDUCE && (value & binary_tables::value_mask) < rules.size())) :
+					symbol < non_terminals && value < state_total;
+				if (!valid) return error = "invalid row", false;
+				(index < action_count ? row->actions : row->gotos).emplace_back(symbol, value);
+			}
+			if (!std::is_sorted(row->actions.begin(), row->actions.end()) || !std::is_sorted(row->gotos.begin(), row->gotos.end())) return error = "invalid row", false;
+			saved_rows[&kernel - saved_kernels.data()] = std::move(row);
+		}
+		if (saved_kernels[0] != kernels[0]) return error = "invalid start state", false;
+		std::unordered_set<Kernel, ItemHash> distinct(saved_kernels.begin(), saved_kernels.end());
+		if (distinct.size() != saved_kernels.size()) return error = "duplicate state", false;
+
+		clear_states();
+		for (auto& kernel : saved_kernels) intern(std::move(kernel));
+		for (uint32_t state = 0; state < state_total; state++) {
+			if (!saved_rows[state]) continue;
+			built_rows.push_back(std::move(*saved_rows[state]));
+			publish(state, &built_rows.back());
+		}
+		return true;
+	}
+};
+
+} // namespace lazy_tables
@@ -0,0 +1,290 @@
+#pragma once
+
+// Opt-in hot-path instrumentation for parse functions written against the generated tables.
+//
+// The parse function reports what it does through the PARSEGEN_PROFILE_* macros below. Unless
+// PARSEGEN_PROFILE is defined when compiling, the macros expand to nothing (their arguments are not
+// even evaluated), so an uninstrumented build pays nothing for them.
+//
+// With PARSEGEN_PROFILE defined, every thread counts into its own set of counters, registered on first
+// use. The counters are only ever written by their own thread, so counting is a plain load and store,
+// without locking or read-modify-write atomics. When a thread exits, its counts are added to a single
+// set of retired counters and its own are freed. parse_profile::merged() sums the counters of every
+// running thread and the retired ones on demand, and the result can be exported as JSON or as CSV;
+// PARSEGEN_PROFILE_EXPORT writes it to $PARSEGEN_PROFILE_OUTPUT (default: 'parse-profile.csv').
+// The CSV can be fed back to 'parsegen --profile' to lay out the tables of the same grammar.
+//
+// Indices past PARSEGEN_PROFILE_MAX_STATES/_RULES/_TERMINALS are not counted individually, but
+// added to 'dropped', so define larger maxima before including this header for very large grammars.
+
+#define PARSEGEN_PROFILE_CSV_HEADER "kind,index,count,name"
+
+#ifdef PARSEGEN_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifndef PARSEGEN_PROFILE_MAX_STATES
+#define PARSEGEN_PROFILE_MAX_STATES 4096
+#endif
+
+#ifndef PARSEGEN_PROFILE_MAX_RULES
+#define PARSEGEN_PROFILE_MAX_RULES 4096
+#endif
+
+#ifndef PARSEGEN_PROFILE_MAX_TERMINALS
+#define PARSEGEN_PROFILE_MAX_TERMINALS 256
+#endif
+
+namespace parse_profile {
+
+// Counters of a single thread. Only the owning thread writes them; other threads may read them
+// at any time through merged().
+struct ThreadCounters {
+	std::atomic<uint64_t> lookups[PARSEGEN_PROFILE_MAX_STATES]{};         // table lookups with this state on top
+	std::atomic<uint64_t> shifts[PARSEGEN_PROFILE_MAX_STATES]{};          // SHIFT (and SHIFT_REDUCE) actions out of this state
+	std::atomic<uint64_t> misses[PARSEGEN_PROFILE_MAX_STATES]{};          // failed actionTable/gotoTable lookups in this state
+	std::atomic<uint64_t> reductions[PARSEGEN_PROFILE_MAX_RULES]{};       // REDUCE actions, by index into reduce_info
+	std::atomic<uint64_t> terminal_shifts[PARSEGEN_PROFILE_MAX_TERMINALS]{}; // shifts, by TokenType
+	std::atomic<uint64_t> max_depth{};                                   // state stack high-water mark
+	std::atomic<uint64_t> dropped{};                                     // counts with an index beyond the maxima
+};
+
+inline void bump(std::atomic<uint64_t>& counter) {
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Add the counts of 'from' to 'to'. 'to' must not be counted into meanwhile.
+inline void add_counters(ThreadCounters& to, const ThreadCounters& from) {
+	auto add = [](std::atomic<uint64_t>& total, const std::atomic<uint64_t>& count) {
+		total.store(total.load(std::memory_order_relaxed) + count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	};
+	for (size_t i = 0; i < PARSEGEN_PROFILE_MAX_STATES; i++) {
+		add(to.lookups[i], from.lookups[i]);
+		add(to.shifts[i], from.shifts[i]);
+		add(to.misses[i], from.misses[i]);
+	}
+	for (size_t i = 0; i < PARSEGEN_PROFILE_MAX_RULES; i++) add(to.reductions[i], from.reductions[i]);
+	for (size_t i = 0; i < PARSEGEN_PROFILE_MAX_TERMINALS; i++) add(to.terminal_shifts[i], from.terminal_shifts[i]);
+	auto depth = from.max_depth.load(std::memory_order_relaxed);
+	if (depth > to.max_depth.load(std::memory_order_relaxed)) to.max_depth.store(depth, std::memory_order_relaxed);
+	add(to.dropped, from.dropped);
+}
+
+struct Registry {
+	std::mutex mutex;
+	std::vector<ThreadCounters*> threads; // of the running threads
+	ThreadCounters retired;               // sum of the counters of the threads that have exited
+};
+
+inline Registry& registry() {
+	static Registry instance;
+	return instance;
+}
+
+// A thread's counters, from its first count to its exit, when they are folded into the retired ones
+class Registration {
+	std::unique_ptr<ThreadCounters> owned = std::make_unique<ThreadCounters>();
+
+public:
+	ThreadCounters& counters = *owned;
+
+	Registration() {
+		auto& instance = registry();
+		std::lock_guard<std::mutex> lock(instance.mutex);
+		instance.threads.push_back(owned.get());
+	}
+
+	~Registration() {
+		auto& instance = registry();
+		std::lock_guard<std::mutex> lock(instance.mutex);
+		add_counters(instance.retired, *owned);
+		instance.threads.erase(std::find(instance.threads.begin(), instance.threads.end(), owned.get()));
+	}
+
+	Registration(const Registration&) = delete;
+	Registration& operator=(const Registration&) = delete;
+};
+
+// The calling thread's counters, registered on first use
+inline ThreadCounters& local() {
+	thread_local Registration registration;
+	return registration.counters;
+}
+
+inline void count_lookup(size_t state) {
+	auto& counters = local();
+	if (state < PARSEGEN_PROFILE_MAX_STATES) bump(counters.lookups[state]);
+	else bump(counters.dropped);
+}
+
+inline void count_shift(size_t state, size_t terminal) {
+	auto& counters = local();
+	if (state < PARSEGEN_PROFILE_MAX_STATES) bump(counters.shifts[state]);
+	else bump(counters.dropped);
+	if (terminal < PARSEGEN_PROFILE_MAX_TERMINALS) bump(counters.terminal_shifts[terminal]);
+	else bump(counters.dropped);
+}
+
+inline void count_reduce(size_t rule) {
+	auto& counters = local();
+	if (rule < PARSEGEN_PROFILE_MAX_RULES) bump(counters.reductions[rule]);
+	else bump(counters.dropped);
+}
+
+inline void count_miss(size_t state) {
+	auto& counters = local();
+	if (state < PARSEGEN_PROFILE_MAX_STATES) bump(counters.misses[state]);
+	else bump(counters.dropped);
+}
+
+inline void count_depth(size_t depth) {
+	auto& counters = local();
+	if (depth > counters.max_depth.load(std::memory_order_relaxed)) {
+		counters.max_depth.store(depth, std::memory_order_relaxed);
+	}
+}
+
+// Sum of the counters of every thread, trimmed to the highest index counted.
+struct Profile {
+	std::vector<uint64_t> lookups, shifts, misses, reductions, terminal_shifts;
+	uint64_t max_depth = 0;
+	uint64_t dropped = 0;
+};
+
+inline Profile merged() {
+	Profile profile;
+	profile.lookups.assign(PARSEGEN_PROFILE_MAX_STATES, 0);
+	profile.shifts.assign(PARSEGEN_PROFILE_MAX_STATES, 0);
+	profile.misses.assign(PARSEGEN_PROFILE_MAX_STATES, 0);
+	profile.reductions.assign(PARSEGEN_PROFILE_MAX_RULES, 0);
+	profile.terminal_shifts.assign(PARSEGEN_PROFILE_MAX_TERMINALS, 0);
+
+	auto add = [&profile](const ThreadCounters& counters) {
+		for (size_t i = 0; i < PARSEGEN_PROFILE_MAX_STATES; i++) {
+			profile.lookups[i] += counters.lookups[i].load(std::memory_order_relaxed);
+			profile.shifts[i] += counters.shifts[i].load(std::memory_order_relaxed);
+			profile.misses[i] += counters.misses[i].load(std::memory_order_relaxed);
+		}
+		for (size_t i = 0; i < PARSEGEN_PROFILE_MAX_RULES; i++) {
+			profile.reductions[i] += counters.reductions[i].load(std::memory_order_relaxed);
+		}
+		for (size_t i = 0; i < PARSEGEN_PROFILE_MAX_TERMINALS; i++) {
+			profile.terminal_shifts[i] += counters.terminal_shifts[i].load(std::memory_order_relaxed);
+		}
+		auto depth = counters.max_depth.load(std::memory_order_relaxed);
+		if (depth > profile.max_depth) profile.max_depth = depth;
+		profile.dropped += counters.dropped.load(std::memory_order_relaxed);
+	};
+
+	auto& instance = registry();
+	std::lock_guard<std::mutex> lock(instance.mutex);
+	add(instance.retired);
+	for (auto thread : instance.threads) add(*thread);
+
+	// length up to the last non-zero count
+	auto used = [](const std::vector<uint64_t>& counts) {
+		auto length = counts.size();
+		while (length > 0 && counts[length - 1] == 0) --length;
+		return length;
+	};
+	// the per-state arrays are trimmed together, so they keep the same length
+	auto states = std::max(used(profile.lookups), std::max(used(profile.shifts), used(profile.misses)));
+	profile.lookups.resize(states);
+	profile.shifts.resize(states);
+	profile.misses.resize(states);
+	profile.reductions.resize(used(profile.reductions));
+	profile.terminal_shifts.resize(used(profile.terminal_shifts));
+	return profile;
+}
+
+// 'rules' is the generated reduce_info vector, used to name every rule by the symbol it reduces to.
+inline void write_json(std::ostream& out, const std::vector<std::pair<std::string_view, size_t>>& rules) {
+	auto profile = merged();
+	auto write_array = [&out](const char* name, const std::vector<uint64_t>& counts) {
+		out << "  \"" << name << "\": [";
+		for (size_t i = 0; i < counts.size(); i++) {
+			out << (i ? ", " : "") << counts[i];
+		}
+		out << "],\n";
+	};
+
+	out << "{\n";
+	write_array("state_lookups", profile.lookups);
+	write_array("state_shifts", profile.shifts);
+	write_array("state_misses", profile.misses);
+	write_array("terminal_shifts", profile.terminal_shifts);
+	out << "  \"rule_reductions\": [";
+	for (size_t rule = 0; rule < profile.reductions.size(); rule++) {
+		out << (rule ? ", " : "") << "{ \"rule\": " << rule << ", \"symbol\": \""
+			<< (rule < rules.size() ? rules[rule].first : "") << "\", \"count\": " << profile.reductions[rule] << " }";
+	}
+	out << "],\n"
+		<< "  \"max_stack_depth\": " << profile.max_depth << ",\n"
+		<< "  \"dropped\": " << profile.dropped << "\n"
+		<< "}\n";
+}
+
+inline void write_csv(std::ostream& out, const std::vector<std::pair<std::string_view, size_t>>& rules) {
+	auto profile = merged();
+	out << PARSEGEN_PROFILE_CSV_HEADER "\n";
+	for (size_t state = 0; state < profile.lookups.size(); state++) {
+		out << "lookups," << state << "," << profile.lookups[state] << ",\n"
+			<< "shifts," << state << "," << profile.shifts[state] << ",\n"
+			<< "misses," << state << "," << profile.misses[state] << ",\n";
+	}
+	for (size_t terminal = 0; terminal < profile.terminal_shifts.size(); terminal++) {
+		out << "terminal_shifts," << terminal << "," << profile.terminal_shifts[terminal] << ",\n";
+	}
+	for (size_t rule = 0; rule < profile.reductions.size(); rule++) {
+		out << "reductions," << rule << "," << profile.reductions[rule] << "," << (rule < rules.size() ? rules[rule].first : "") << "\n";
+	}
+	out << "max_depth,0," << profile.max_depth << ",\n"
+		<< "dropped,0," << profile.dropped << ",\n";
+}
+
+// Write the merged counters to 'path': JSON if it ends in '.json', CSV otherwise.
+inline bool export_to(const std::string& path, const std::vector<std::pair<std::string_view, size_t>>& rules) {
+	std::ofstream file(path, std::ios::out);
+	if (!file.is_open()) return false;
+	if (path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0) write_json(file, rules);
+	else write_csv(file, rules);
+	return true;
+}
+
+// Export to the file named by the PARSEGEN_PROFILE_OUTPUT environment variable, or 'parse-profile.csv',
+// which 'parsegen --profile' reads back.
+inline bool export_to_env(const std::vector<std::pair<std::string_view, size_t>>& rules) {
+	auto path = std::getenv("PARSEGEN_PROFILE_OUTPUT");
+	return export_to(path ? path : "parse-profile.csv", rules);
+}
+
+} // namespace parse_profile
+
+#define PARSEGEN_PROFILE_LOOKUP(state) parse_profile::count_lookup(state)
+#define PARSEGEN_PROFILE_SHIFT(state, terminal) parse_profile::count_shift(state, terminal)
+#define PARSEGEN_PROFILE_REDUCE(rule) parse_profile::count_reduce(rule)
+#define PARSEGEN_PROFILE_MISS(state) parse_profile::count_miss(state)
+#define PARSEGEN_PROFILE_DEPTH(depth) parse_profile::count_depth(depth)
+#define PARSEGEN_PROFILE_EXPORT(rules) parse_profile::export_to_env(rules)
+
+#else
+
+#define PARSEGEN_PROFILE_LOOKUP(state) ((void)0)
+#define PARSEGEN_PROFILE_SHIFT(state, terminal) ((void)0)
+#define PARSEGEN_PROFILE_REDUCE(rule) ((void)0)
+#define PARSEGEN_PROFILE_MISS(state) ((void)0)
+#define PARSEGEN_PROFILE_DEPTH(depth) ((void)0)
+#define PARSEGEN_PROFILE_EXPORT(rules) ((void)0)
+
+#endif
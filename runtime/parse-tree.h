@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// A parse tree built from the shifts and reductions of a parse function (Tables::parse() of the binary,
+// lazy and compile-time runtimes, direct_parse() of --emit-code, or one written against the generated
+// tables), without writing a semantic action per rule:
+//
+//   parse_tree::Tree tree;
+//   tables.parse(tokens, count, states,
+//       [&](size_t position) { tree.shift(position); },
+//       [&](uint32_t rule) { tree.reduce(rule, tables.rule_pop_count(rule)); });
+//
+// A node is a reduction: the rule it reduced by (an index into reduce_info), its children (the nodes
+// reduced to its RHS non-terminals, left to right) and its token span (the positions of the first and
+// one past the last token it covers). Tokens are not nodes; the tokens between two children are the gap
+// between their spans. Nodes are numbered in postorder, as the parser reduces them, so children come
+// before their parent, the root is the last node, and a loop over the nodes in order is a bottom-up walk.
+//
+// The tree is a struct of arrays, one array per field, and a node's children are a contiguous range
+// of 'children'. The arrays only grow by reallocation (reserve() to avoid even that), never by a node,
+// so building costs no allocation per node, and clear() keeps their storage for the next tree.
+// release() frees the whole tree at once.
+//
+// Rules removed by --chain-elim are never reduced by, so they have no nodes.
+
+namespace parse_tree {
+
+constexpr uint32_t none = 0xffffffff;
+
+class Tree {
+	std::vector<uint32_t> rules;          // per node: index into reduce_info
+	std::vector<uint32_t> token_begins;   // per node: first token
+	std::vector<uint32_t> token_ends;     // per node: one past the last token
+	std::vector<uint32_t> child_offsets;  // per node, and one past the last: where its children start in 'children'
+	std::vector<uint32_t> children;
+
+	// The symbols of the RHS being parsed, as the parser's state stack holds their states: a node, or
+	// 'none' for a token, and the tokens it spans
+	struct Symbol {
+		uint32_t node;
+		uint32_t token_begin;
+		uint32_t token_end;
+	};
+	std::vector<Symbol> symbols;
+	uint32_t next_token = 0;
+
+public:
+	Tree() {
+		child_offsets.push_back(0);
+	}
+
+	// Room for 'nodes' nodes without reallocating
+	void reserve(size_t nodes) {
+		rules.reserve(nodes);
+		token_begins.reserve(nodes);
+		token_ends.reserve(nodes);
+		child_offsets.reserve(nodes + 1);
+		children.reserve(nodes);
+		symbols.reserve(nodes);
+	}
+
+	// Empties the tree, keeping its storage
+	void clear() {
+		rules.clear();
+		token_begins.clear();
+		token_ends.clear();
+		child_offsets.resize(1);
+		children.clear();
+		symbols.clear();
+		next_token = 0;
+	}
+
+	// Empties the tree and frees its storage
+	void release() {
+		*this = Tree();
+	}
+
+	// on_shift(position)
+	void shift(size_t position) {
+		next_token = static_cast<uint32_t>(position + 1);
+		symbols.push_back({ none, static_cast<uint32_t>(position), next_token });
+	}
+
+	// on_reduce(rule), with reduce_info[rule].second as 'pop_count'. Returns the new node.
+	uint32_t reduce(uint32_t rule, size_t pop_count) {
+		auto node = static_cast<uint32_t>(rules.size());
+		auto first = symbols.end() - pop_count;
+		uint32_t token_begin = pop_count ? first->token_begin : next_token;
+		uint32_t token_end = pop_count ? symbols.back().token_end : next_token;
+		for (auto symbol = first; symbol != symbols.end(); ++symbol) {
+			if (symbol->node != none) children.push_back(symbol->node);
+		}
+		symbols.erase(first, symbols.end());
+		symbols.push_back({ node, token_begin, token_end });
+
+		rules.push_back(rule);
+		token_begins.push_back(token_begin);
+		token_ends.push_back(token_end);
+		child_offsets.push_back(static_cast<uint32_t>(children.size()));
+		return node;
+	}
+
+	size_t size() const { return rules.size(); }
+	bool empty() const { return rules.empty(); }
+
+	// The last node reduced, or 'none'
+	uint32_t root() const {
+		return rules.empty() ? none : static_cast<uint32_t>(rules.size() - 1);
+	}
+
+	uint32_t rule(uint32_t node) const { return rules[node]; }
+	uint32_t token_begin(uint32_t node) const { return token_begins[node]; }
+	uint32_t token_end(uint32_t node) const { return token_ends[node]; }
+
+	// The children of 'node', as a range of node indices
+	std::pair<const uint32_t*, const uint32_t*> children_of(uint32_t node) const {
+		return { children.data() + child_offsets[node], children.data() + child_offsets[node + 1] };
+	}
+
+	uint32_t child_count(uint32_t node) const {
+		return child_offsets[node + 1] - child_offsets[node];
+	}
+};
+
+} // namespace parse_tree